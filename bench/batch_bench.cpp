@@ -0,0 +1,69 @@
+#include <parser/batch.h>
+#include <utils/thread_pool.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Quest-like lines: titles, hover texts, gradients, links...
+static std::vector<std::string> makeCorpus(size_t lines)
+{
+    const std::vector<std::string> templates = {
+        "Collect &a16 iron ingots&r to continue",
+        "&lChapter &6%d&r - &oThe beginning",
+        "&@gradient:\"1,#FF5555,#5555FF\"Welcome to the pack, adventurer number %d&r!",
+        "&@gradient:\"2,#FFAA00,#FFFF55,#55FF55\"Rainbow road %d",
+        "Check the &@url:\"https://example.com/wiki\"&9&nwiki page&r for details on %d",
+        "Hover this&&text:\"Quest reward %d\" and this one too&&item:\"minecraft:diamond\"",
+        "&&shadow:\"#FF202020\"Shadowed line %d&@copy:\"/give @p stone\" copy me",
+        "Plain description line number %d without any formatting at all"
+    };
+
+    std::mt19937 gen(54);
+    std::vector<std::string> corpus;
+    corpus.reserve(lines);
+    char buffer[256];
+    for(size_t i = 0; i < lines; i++)
+    {
+        const auto& pattern = templates[gen() % templates.size()];
+        std::snprintf(buffer, sizeof(buffer), pattern.c_str(), static_cast<int>(i));
+        corpus.emplace_back(buffer);
+    }
+    return corpus;
+}
+
+//Usage: batch_bench [lines] [max threads]
+int main(int argc, char** argv)
+{
+    const size_t lines = argc > 1 ? std::stoul(argv[1]) : 200000;
+    const auto corpus = makeCorpus(lines);
+    const unsigned max_threads = argc > 2 ? std::stoul(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<unsigned> thread_counts;
+    for(unsigned threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    std::string reference;
+    std::printf("lines: %zu\n", lines);
+    for(unsigned threads : thread_counts)
+    {
+        utils::thread_pool pool(threads);
+        raw::batch::convert(corpus, {}, pool); //warm up
+
+        auto start = std::chrono::steady_clock::now();
+        auto result = raw::batch::convert(corpus, {}, pool);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if(reference.empty()) reference = result.arena;
+        bool same = result.arena == reference && result.errors.empty();
+
+        std::printf("threads: %2u  %10.0f lines/s  %7.1f MB/s out  %s\n",
+                    threads, lines / seconds, result.arena.size() / seconds / 1e6,
+                    same ? "ok" : "MISMATCH");
+        if(!same) return 1;
+    }
+    return 0;
+}
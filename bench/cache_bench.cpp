@@ -0,0 +1,68 @@
+#include <parser/cache.h>
+#include <utils/thread_pool.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+//A pack repeats itself: few templates, many copies of each text
+static std::vector<std::string> makeCorpus(size_t lines, size_t different)
+{
+    const std::vector<std::string> templates = {
+        "Collect &a16 iron ingots&r to continue %zu",
+        "&lChapter &6%zu&r - &oThe beginning&@url:\"https://example.com\" wiki",
+        "&@gradient:\"1,#FF5555,#5555FF\"Welcome to the pack, adventurer number %zu&r!&&text:\"hi\"",
+        "Hover this&&text:\"Quest reward %zu\" and this one too&&item:\"minecraft:diamond\""
+    };
+
+    std::mt19937 gen(54);
+    std::vector<std::string> corpus;
+    corpus.reserve(lines);
+    char buffer[256];
+    for(size_t i = 0; i < lines; i++)
+    {
+        const size_t which = gen() % different;
+        std::snprintf(buffer, sizeof(buffer), templates[which % templates.size()].c_str(), which);
+        corpus.emplace_back(buffer);
+    }
+    return corpus;
+}
+
+static double run(const std::vector<std::string>& corpus, raw::ConversionCache* cache, utils::thread_pool& pool, std::string& arena)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto result = cache ? raw::batch::convert(corpus, {}, *cache, pool) : raw::batch::convert(corpus, {}, pool);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    arena = std::move(result.arena);
+    return seconds;
+}
+
+//Usage: cache_bench [lines] [different texts] [budget MiB]
+int main(int argc, char** argv)
+{
+    const size_t lines = argc > 1 ? std::stoul(argv[1]) : 200000;
+    const size_t different = argc > 2 ? std::stoul(argv[2]) : 2000;
+    const size_t budget = (argc > 3 ? std::stoul(argv[3]) : 32) << 20;
+    const auto corpus = makeCorpus(lines, different);
+    utils::thread_pool& pool = utils::thread_pool::shared();
+
+    std::string reference, cached;
+    const double plain = run(corpus, nullptr, pool, reference);
+    raw::ConversionCache cache(budget);
+    const double cold = run(corpus, &cache, pool, cached);
+    bool same = cached == reference;
+    const double warm = run(corpus, &cache, pool, cached);
+    same = same && cached == reference;
+
+    const auto stats = cache.stats();
+    std::printf("lines: %zu, different: %zu, budget: %zu MiB\n", lines, different, budget >> 20);
+    std::printf("no cache   %10.0f lines/s\n", lines / plain);
+    std::printf("cold cache %10.0f lines/s\n", lines / cold);
+    std::printf("warm cache %10.0f lines/s\n", lines / warm);
+    std::printf("hits %zu, misses %zu (%.1f%%), evictions %zu, %zu entries in %zu bytes  %s\n",
+                stats.hits, stats.misses, stats.hitRate() * 100.0, stats.evictions, stats.entries, stats.bytes,
+                same ? "ok" : "MISMATCH");
+    return same ? 0 : 1;
+}
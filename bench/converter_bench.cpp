@@ -0,0 +1,514 @@
+#include <parser/incremental.h>
+#include <parser/layout.h>
+#include <parser/raw.h>
+#include <parser/reverse.h>
+#include <parser/stream.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Every allocation of the program goes through here, so a call can be counted
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+//Out of line so the optimizer never sees free() on a pointer from operator new
+[[gnu::noinline]] static void release(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+
+//Kinds of text the converter sees, each one stresses a different part
+enum class Kind { PLAIN, FORMATTING, GRADIENT, EVENTS, UTF8 };
+
+struct Category
+{
+    Kind kind;
+    const char* name;
+};
+
+static constexpr Category CATEGORIES[] = {
+    {Kind::PLAIN, "plain"},
+    {Kind::FORMATTING, "formatting"},
+    {Kind::GRADIENT, "gradient"},
+    {Kind::EVENTS, "events"},
+    {Kind::UTF8, "utf8"},
+};
+
+/**
+ * @brief Deterministic quest-like text of about bytes bytes
+ * Only gen() % n is used (no distributions), so the same seed gives the same text everywhere
+ */
+static std::string makeText(Kind kind, size_t bytes, std::mt19937& gen)
+{
+    static const char* words[] = {"iron", "ingot", "the", "chapter", "quest", "diamond", "reward", "collect",
+                                  "village", "smelter", "and", "to", "of", "blacksmith", "night", "dragon"};
+    static const char* utf8_words[] = {"café", "niño", "über", "Привет", "мир", "日本語", "한국어", "🎉", "👍🏽", "é"};
+    static const char* clicks[] = {"url:\"https://example.com/wiki\"", "command:\"/give @p stone\"", "copy:\"seed\"",
+                                   "change:\"2\"", "in:\"say hi\"", "file:\"notes.txt\""};
+    static const char* hovers[] = {"text:\"Quest reward\"", "item:\"minecraft:diamond\"", "shadow:\"#FF202020\""};
+    static const char codes[] = "0123456789abcdeflomnkr";
+
+    auto hex = [&]() {
+        static constexpr char digits[] = "0123456789ABCDEF";
+        std::string color = "#";
+        for(int i = 0; i < 6; i++) color += digits[gen() % 16];
+        return color;
+    };
+
+    std::string text;
+    while(text.size() < bytes)
+    {
+        switch(kind)
+        {
+            case Kind::PLAIN:
+                break;
+            case Kind::FORMATTING:
+                if(gen() % 2 == 0)
+                {
+                    text += '&';
+                    text += codes[gen() % (sizeof(codes) - 1)];
+                }
+                if(gen() % 6 == 0) text += "&" + hex();
+                break;
+            case Kind::GRADIENT:
+                if(gen() % 6 == 0)
+                {
+                    const unsigned stops = 2 + gen() % 3;
+                    text += "&@gradient:\"";
+                    text += gen() % 2 ? '1' : '2';
+                    for(unsigned i = 0; i < stops; i++) text += "," + hex();
+                    text += '"';
+                }
+                break;
+            case Kind::EVENTS:
+                if(gen() % 3 == 0)
+                {
+                    text += "&@";
+                    text += clicks[gen() % std::size(clicks)];
+                }
+                break;
+            case Kind::UTF8:
+                if(gen() % 8 == 0) text += "&@gradient:\"1," + hex() + "," + hex() + "\"";
+                else if(gen() % 4 == 0) text += "&l";
+                text += utf8_words[gen() % std::size(utf8_words)];
+                text += ' ';
+                break;
+        }
+        text += words[gen() % std::size(words)];
+        text += ' ';
+        text += words[gen() % std::size(words)];
+        if(kind == Kind::EVENTS && gen() % 3 == 0)
+        {
+            text += "&&";
+            text += hovers[gen() % std::size(hovers)];
+        }
+        text += gen() % 10 == 0 ? ". " : " ";
+    }
+    return text;
+}
+
+static std::vector<std::string> makeCorpus(Kind kind, size_t count, size_t bytes, uint32_t seed)
+{
+    std::mt19937 gen(seed);
+    std::vector<std::string> corpus;
+    corpus.reserve(count);
+    for(size_t i = 0; i < count; i++) corpus.push_back(makeText(kind, bytes, gen));
+    return corpus;
+}
+
+//Option sets the golden outputs are checked with, together they cover every writer
+struct Variant
+{
+    const char* name;
+    raw::Options options;
+};
+
+static const Variant VARIANTS[] = {
+    {"array", {false, raw::gradient::Mode::SRGB, false, 0.0f}},
+    {"extra+oklab", {true, raw::gradient::Mode::OKLAB, false, 0.0f}},
+    {"minimize+hsv", {false, raw::gradient::Mode::HSV, true, 0.0f}},
+    {"array+delta_e", {false, raw::gradient::Mode::SRGB, false, 2.0f}},
+};
+
+struct Measure
+{
+    double ns_per_byte = 0;
+    double allocations_per_call = 0;
+};
+
+//Runs fn over the corpus until it took at least min_seconds
+template<class Fn>
+static Measure measure(const std::vector<std::string>& corpus, Fn&& fn, double min_seconds)
+{
+    size_t bytes = 0;
+    for(const auto& text : corpus) bytes += text.size();
+
+    //one pass to count allocations (and warm up)
+    size_t sink = 0;
+    const size_t before = allocations.load();
+    for(const auto& text : corpus) sink += fn(text).size();
+    const size_t allocated = allocations.load() - before;
+
+    size_t passes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    double seconds = 0;
+    do
+    {
+        for(const auto& text : corpus) sink += fn(text).size();
+        passes++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while(seconds < min_seconds);
+
+    if(sink == 0) std::puts("");
+    return {seconds * 1e9 / static_cast<double>(bytes * passes), static_cast<double>(allocated) / corpus.size()};
+}
+
+static std::string jsonString(std::string_view text)
+{
+    std::string out = "\"";
+    raw::json_escape_to(out, text);
+    out += '"';
+    return out;
+}
+
+//Golden corpus: small texts of every kind, every option set
+static std::vector<std::string> goldenLines()
+{
+    std::vector<std::string> lines;
+    for(const Category& category : CATEGORIES)
+    {
+        for(const std::string& input : makeCorpus(category.kind, 8, 48, 1234))
+        {
+            for(const Variant& variant : VARIANTS)
+            {
+                lines.push_back("{\"options\":" + jsonString(variant.name) + ",\"input\":" + jsonString(input) +
+                                ",\"output\":" + jsonString(raw::to_json(input, variant.options)) + "}");
+            }
+        }
+    }
+    return lines;
+}
+
+static int writeGolden(const char* path)
+{
+    std::ofstream out(path, std::ios::binary);
+    for(const auto& line : goldenLines()) out << line << '\n';
+    if(!out)
+    {
+        std::fprintf(stderr, "Couldn't write %s\n", path);
+        return 1;
+    }
+    std::printf("golden outputs written to %s\n", path);
+    return 0;
+}
+
+//Inputs that broke once, on paths the golden corpus doesn't go through (build with -fsanitize=address to see the worst)
+static size_t checkRegressions()
+{
+    size_t checked = 0;
+    size_t failed = 0;
+    auto expect = [&](const char* name, bool ok, const std::string& got = {}, const std::string& expected = {}) {
+        checked++;
+        if(ok) return;
+        failed++;
+        std::fprintf(stderr, "regression: %s\n  expected: %s\n  got:      %s\n", name, expected.c_str(), got.c_str());
+    };
+
+    {
+        raw::Report report;
+        report.original_bytes = 10;
+        report.output_bytes = 12;
+        expect("bytesSaved of a report whose output grew", report.bytesSaved() == 0, std::to_string(report.bytesSaved()), "0");
+    }
+
+    {
+        //a reused segment kept a state pointing into a segment the cache had freed
+        raw::IncrementalConverter converter;
+        raw::Options options;
+        options.minimize = true;
+        for(const char* first : {"A", "Z", "Y"})
+        {
+            const std::string text = std::string(first) + "&@url:\"https://example.com/wiki\"&@pageB";
+            converter.update(text, options);
+            const std::string expected = raw::to_json(text, options);
+            expect("incremental minimize after the first piece changed", converter.output() == expected, converter.output(), expected);
+        }
+    }
+
+    {
+        //the click of the first write() was still pointing into its freed piece in the second one
+        std::ostringstream out;
+        {
+            raw::StreamConverter converter(out);
+            converter.write("Go &@url:\"https://example.com/wiki\"&l");
+            converter.write("Click me&r now");
+        }
+        const std::string expected = raw::to_json("Go &@url:\"https://example.com/wiki\"&lClick me&r now");
+        expect("stream with a click carried into the next write()", out.str() == expected, out.str(), expected);
+    }
+
+    {
+        //a bare command glued to a word was matched by its prefix, &@pageX became a page break and "X"
+        const std::string got = raw::to_json("&@pageX");
+        expect("&@pageX stays text", got == "&@pageX", got, "&@pageX");
+    }
+
+    {
+        //&@page right before a word: fit and from_json write it, to_json has to read a page break back
+        auto count = [](const std::string& text, std::string_view what) {
+            size_t found = 0;
+            for(size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + what.size())) found++;
+            return found;
+        };
+        raw::layout::Options layout;
+        layout.width = 60;
+        layout.lines_per_page = 1;
+        const std::string fitted = raw::layout::fit("&@url:\"u\"alpha beta gamma delta epsilon zeta", layout);
+        const std::string json = raw::to_json(fitted);
+        expect("fit() page breaks before a word are page breaks",
+               count(fitted, "&@page") > 0 && count(json, "{@pagebreak}") == count(fitted, "&@page") && count(json, "&@page") == 0,
+               json, fitted);
+
+        const std::string markup = raw::from_json(R"([{"text":"First"},{"text":"\n{@pagebreak}\n"},{"text":"Second"}])");
+        const std::string back = raw::to_json(markup);
+        expect("from_json page break before a word round-trips",
+               count(back, "{@pagebreak}") == 1 && count(back, "&@page") == 0 && raw::from_json(back) == markup, back, markup);
+    }
+
+    //reverse: what can't be written back (or isn't valid JSON) is an error, not broken markup
+    auto rejects = [](const char* json) {
+        try
+        {
+            raw::from_json(json);
+            return false;
+        }
+        catch(const raw::reverse::ParseError&)
+        {
+            return true;
+        }
+    };
+    expect("click value with a quote is rejected",
+           rejects(R"({"text":"T","clickEvent":{"action":"open_url","value":"say \"hi\""}})"));
+    expect("hover value ending with a backslash is rejected",
+           rejects(R"({"text":"T","hoverEvent":{"action":"show_text","contents":"back\\"}})"));
+    expect("text with an & command in it is rejected", rejects(R"([{"text":"Tom&amp Jerry &ab","color":"red"}])"));
+    {
+        const std::string markup = raw::from_json(R"([{"text":"a & b && c &","color":"red"}])");
+        expect("text with & that isn't a command is kept", markup == "&ca & b && c &", markup, "&ca & b && c &");
+    }
+    {
+        //a collapsed type 2 gradient whose text started with #123456 took it as a fourth stop
+        const std::string_view text = "#123456789ABCDEF0";
+        const raw::gradient::rgb stops[] = {0xFF0000, 0x00FF00, 0x0000FF};
+        raw::gradient::rgb colors[17];
+        raw::gradient::sample(stops, 3, text.size(), 0, text.size(), raw::gradient::Mode::SRGB, colors);
+        std::string json = "[";
+        for(size_t i = 0; i < text.size(); i++)
+        {
+            char hex[6];
+            raw::gradient::write_hex(hex, colors[i]);
+            json += "{\"text\":\"" + std::string(1, text[i]) + "\",\"color\":\"#" + std::string(hex, 6) + "\"},";
+        }
+        json += R"({"text":"!","hoverEvent":{"action":"show_text","contents":"x"}}])";
+        const std::string back = raw::to_json(raw::from_json(json));
+        const auto want = raw::reverse::read_runs(json);
+        const auto got = raw::reverse::read_runs(back);
+        bool same = want.size() == got.size();
+        for(size_t i = 0; same && i < want.size(); i++)
+        {
+            raw::gradient::rgb a = 0, b = 0;
+            raw::gradient::parse_rgb(want[i].style.color, a);
+            raw::gradient::parse_rgb(got[i].style.color, b);
+            for(int shift = 0; shift <= 16; shift += 8)
+            {
+                const int delta = static_cast<int>((a >> shift) & 0xFF) - static_cast<int>((b >> shift) & 0xFF);
+                same = same && want[i].text == got[i].text && delta >= -1 && delta <= 1;
+            }
+        }
+        expect("gradient text starting with # round-trips", same, back, json);
+    }
+    expect("unpaired high surrogate is rejected", rejects(R"({"text":"\ud800x"})"));
+    expect("high surrogate with a non low half is rejected", rejects(R"({"text":"\ud800A"})"));
+    expect("lone low surrogate is rejected", rejects(R"({"text":"\udc00"})"));
+    {
+        const std::string json = R"({"text":"T","clickEvent":{"action":"open_url","value":"a && b \\\"c"}})";
+        const std::string back = raw::to_json(raw::from_json(json));
+        std::string value;
+        for(const raw::reverse::Run& run : raw::reverse::read_runs(back))
+        {
+            if(run.text == "T") value = run.style.click_value;
+        }
+        expect("click value with & and an escaped quote round-trips", value == "a && b \\\"c", value, "a && b \\\"c");
+    }
+
+    std::printf("regressions: %zu checked, %zu failed\n", checked, failed);
+    return failed;
+}
+
+//Converts every input of the file again, any output that changed is a failure
+static int checkGolden(const char* path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if(!in)
+    {
+        std::fprintf(stderr, "Couldn't open %s\n", path);
+        return 1;
+    }
+
+    size_t checked = 0;
+    size_t failed = 0;
+    size_t line_number = 0;
+    std::string line;
+    while(std::getline(in, line))
+    {
+        line_number++;
+        if(line.empty()) continue;
+
+        std::string options, input, output;
+        try
+        {
+            raw::reverse::Reader reader(line);
+            reader.expect('{');
+            do
+            {
+                const std::string key = reader.readString();
+                reader.expect(':');
+                std::string value = reader.readString();
+                if(key == "options") options = std::move(value);
+                else if(key == "input") input = std::move(value);
+                else if(key == "output") output = std::move(value);
+            } while(reader.consume(','));
+            reader.expect('}');
+        }
+        catch(const std::exception& e)
+        {
+            std::fprintf(stderr, "%s:%zu: %s\n", path, line_number, e.what());
+            failed++;
+            continue;
+        }
+
+        const Variant* variant = nullptr;
+        for(const Variant& v : VARIANTS)
+        {
+            if(options == v.name) variant = &v;
+        }
+        if(!variant)
+        {
+            std::fprintf(stderr, "%s:%zu: unknown options %s\n", path, line_number, options.c_str());
+            failed++;
+            continue;
+        }
+
+        const std::string got = raw::to_json(input, variant->options);
+        checked++;
+        if(got != output)
+        {
+            if(failed < 5)
+            {
+                std::fprintf(stderr, "%s:%zu: output changed (%s)\n  input:    %s\n  expected: %s\n  got:      %s\n",
+                             path, line_number, options.c_str(), input.c_str(), output.c_str(), got.c_str());
+            }
+            failed++;
+        }
+    }
+
+    std::printf("golden: %zu checked, %zu failed\n", checked, failed);
+    failed += checkRegressions();
+    return failed ? 1 : 0;
+}
+
+static void usage()
+{
+    std::fputs("Usage: converter_bench [--bytes <n>] [--texts <n>] [--seconds <s>] [--json <file>]\n"
+               "                       [--golden <file>] [--write-golden <file>]\n"
+               "  --golden checks the outputs of the file before measuring, exit code 1 if any changed\n",
+               stderr);
+}
+
+int main(int argc, char** argv)
+{
+    size_t bytes = 4096;
+    size_t texts = 64;
+    double seconds = 0.3;
+    const char* json_path = nullptr;
+    const char* golden = nullptr;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string_view arg = argv[i];
+        if(i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        if(arg == "--bytes") bytes = std::strtoul(argv[++i], nullptr, 10);
+        else if(arg == "--texts") texts = std::strtoul(argv[++i], nullptr, 10);
+        else if(arg == "--seconds") seconds = std::strtod(argv[++i], nullptr);
+        else if(arg == "--json") json_path = argv[++i];
+        else if(arg == "--golden") golden = argv[++i];
+        else if(arg == "--write-golden") return writeGolden(argv[++i]);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    if(golden && checkGolden(golden) != 0) return 1;
+
+    std::string json = "{\"converter_version\":" + std::to_string(raw::CONVERTER_VERSION) +
+                       ",\"bytes_per_text\":" + std::to_string(bytes) + ",\"results\":[";
+    std::printf("%-11s %16s %16s %14s %14s\n", "corpus", "gradient ns/B", "to_json ns/B", "allocs/call", "MB/s");
+    for(size_t c = 0; c < std::size(CATEGORIES); c++)
+    {
+        const Category& category = CATEGORIES[c];
+        const auto corpus = makeCorpus(category.kind, texts, bytes, 54);
+
+        const Measure gradient = measure(corpus, [](const std::string& text) {
+            return raw::change_gradient(text);
+        }, seconds);
+        const Measure convert = measure(corpus, [](const std::string& text) {
+            return raw::to_json(text, raw::Options{});
+        }, seconds);
+
+        std::printf("%-11s %16.2f %16.2f %14.1f %14.1f\n", category.name, gradient.ns_per_byte, convert.ns_per_byte,
+                    convert.allocations_per_call, 1e3 / convert.ns_per_byte);
+
+        char entry[512];
+        std::snprintf(entry, sizeof(entry),
+                      "%s{\"corpus\":\"%s\",\"change_gradient\":{\"ns_per_byte\":%.4f,\"allocations_per_call\":%.2f},"
+                      "\"to_json\":{\"ns_per_byte\":%.4f,\"allocations_per_call\":%.2f}}",
+                      c ? "," : "", category.name, gradient.ns_per_byte, gradient.allocations_per_call,
+                      convert.ns_per_byte, convert.allocations_per_call);
+        json += entry;
+    }
+    json += "]}\n";
+
+    if(json_path)
+    {
+        std::ofstream out(json_path, std::ios::binary);
+        out << json;
+        if(!out)
+        {
+            std::fprintf(stderr, "Couldn't write %s\n", json_path);
+            return 1;
+        }
+        std::printf("results written to %s\n", json_path);
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <utils/escape.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+//Quest descriptions: mostly letters, some quotes, a newline now and then
+static std::string makeText(size_t bytes, unsigned special_every)
+{
+    static const char words[][12] = {"iron", "ingot", "the", "chapter", "quest", "diamond", "reward", "collect"};
+    std::mt19937 gen(54);
+    std::string text;
+    text.reserve(bytes + 16);
+    while(text.size() < bytes)
+    {
+        text += words[gen() % 8];
+        unsigned roll = gen() % special_every;
+        if(roll == 0) text += '\n';
+        else if(roll == 1) text += "\"";
+        else if(roll == 2) text += '\\';
+        else text += ' ';
+    }
+    text.resize(bytes);
+    return text;
+}
+
+//One byte at a time, what the converters did before
+static void escapeBytewise(std::string& out, std::string_view str)
+{
+    static constexpr char digits[] = "0123456789abcdef";
+    for(char c : str)
+    {
+        switch(c)
+        {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if(static_cast<unsigned char>(c) <= 0x1F)
+                {
+                    out += "\\u00";
+                    out += digits[static_cast<unsigned char>(c) >> 4];
+                    out += digits[static_cast<unsigned char>(c) & 0xF];
+                }
+                else out += c;
+        }
+    }
+}
+
+template<class F>
+static double gigabytesPerSecond(const std::vector<std::string>& texts, size_t total, F&& escape)
+{
+    std::string out;
+    size_t check = 0;
+    auto start = std::chrono::steady_clock::now();
+    size_t rounds = 0;
+    double seconds = 0;
+    do
+    {
+        for(const auto& text : texts)
+        {
+            out.clear();
+            escape(out, text);
+            check += out.size();
+        }
+        rounds++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while(seconds < 0.5);
+    if(check == 0) std::puts("");
+    return static_cast<double>(total) * rounds / seconds / 1e9;
+}
+
+//Usage: escape_bench [text length]
+int main(int argc, char** argv)
+{
+    const size_t length = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200;
+    const size_t total = 16 << 20;
+
+    std::printf("%-24s %12s %12s\n", "text", "bytewise", "escape_to");
+    for(unsigned special_every : {1000u, 40u, 8u})
+    {
+        std::vector<std::string> texts;
+        for(size_t done = 0; done < total; done += length)
+        {
+            texts.push_back(makeText(length, special_every));
+        }
+
+        std::string a, b;
+        for(const auto& text : texts)
+        {
+            escapeBytewise(a, text);
+            utils::append_escaped(b, text);
+        }
+        if(a != b)
+        {
+            std::fprintf(stderr, "Outputs differ\n");
+            return 1;
+        }
+
+        double slow = gigabytesPerSecond(texts, total, escapeBytewise);
+        double fast = gigabytesPerSecond(texts, total, [](std::string& out, std::string_view text) {
+            utils::append_escaped(out, text);
+        });
+        char label[64];
+        std::snprintf(label, sizeof(label), "%zu B, 1 in %u special", length, special_every);
+        std::printf("%-24s %9.2f GB/s %7.2f GB/s\n", label, slow, fast);
+    }
+    return 0;
+}
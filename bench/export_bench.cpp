@@ -0,0 +1,277 @@
+#include <quests/chapter_group.h>
+#include <quests/snbt_reader.h>
+#include <utils/thread_pool.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::string makeId(std::mt19937_64& gen)
+{
+    static constexpr char digits[] = "0123456789ABCDEF";
+    std::string id(16, '0');
+    for(char& c : id) c = digits[gen() % 16];
+    return id;
+}
+
+//Pack of chapters with quests_per_chapter quests each (chained by dependencies) and some reward tables
+static void makePack(chapter_group& pack, size_t chapters, size_t quests_per_chapter, size_t tables)
+{
+    std::mt19937_64 gen(47);
+    quest_store& store = pack.getStore();
+    store.reserve(chapters * quests_per_chapter, chapters + 1);
+    for(size_t c = 0; c < chapters; c++)
+    {
+        chapter new_chapter;
+        new_chapter.changeFileName("chapter_" + std::to_string(c));
+        const chapter_handle ch = store.addChapter(std::move(new_chapter));
+
+        quest_handle previous;
+        for(size_t i = 0; i < quests_per_chapter; i++)
+        {
+            quest q;
+            q.id = makeId(gen);
+            q.title = "Collect the ingots of the smelter";
+            q.description = {"Smelt some iron in the furnace, then bring the ingots back.",
+                             "The blacksmith of the village pays well for them."};
+            //fractional like the ones FTB's editor leaves, a load has to write them back the same
+            q.position = {static_cast<double>(i % 20) + (i % 3 == 0 ? 0.5 : 0.0), static_cast<double>(i / 20) * 1.25};
+            q.shape = i % 5 == 0 ? Shapes::HEXAGON : Shapes::DEFAULT;
+            q.size = i % 7 == 0 ? 1.5f : 0.0f;
+
+            snbt::Compound task;
+            task["id"] = snbt::Tag(makeId(gen));
+            task["type"] = snbt::Tag(std::string("item"));
+            task["count"] = snbt::Tag(snbt::Long(16));
+            q.tasks.emplace_back(std::move(task));
+
+            reward r;
+            r.id = makeId(gen);
+            r.item_id = "minecraft:diamond";
+            r.count = 4;
+            q.rewards.push_back(std::move(r));
+
+            const quest_handle h = store.addQuest(ch, std::move(q));
+            if(previous) store.link(previous, h);
+            previous = h;
+        }
+    }
+    for(size_t t = 0; t < tables; t++)
+    {
+        reward table;
+        table.id = makeId(gen);
+        table.title = "Loot table " + std::to_string(t);
+        table.item_id = "minecraft:emerald";
+        pack.addRewardTable(std::move(table));
+    }
+}
+
+static size_t leftovers(const std::filesystem::path& root)
+{
+    size_t count = 0;
+    for(const auto& entry : std::filesystem::recursive_directory_iterator(root))
+    {
+        if(entry.path().extension() == ".tmp") count++;
+    }
+    return count;
+}
+
+static std::string readFile(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+//Files the pack would write that differ from the ones on disk
+static size_t mismatches(const chapter_group& pack, const std::filesystem::path& root)
+{
+    size_t count = 0;
+    for(const chapter& c : pack.getChapters())
+    {
+        if(readFile(root / "chapters" / (c.fileName() + ".snbt")) != c.generateQuestText(pack.getStore())) count++;
+    }
+    for(const reward& table : pack.getRewardTables())
+    {
+        if(readFile(root / "reward_tables" / (table.id + ".snbt")) != table.generateReward()) count++;
+    }
+    return count;
+}
+
+//Quoted keys with escapes: every value is unescaped once, two keys that end up the same are an error
+static bool checkEscapedKeys()
+{
+    //"\u0062" sorts before a but b after it, it used to be visited (and unescaped) a second time
+    snbt::Tag values = snbt::Parser("{\"\\u0062\": \"x\\\\\\\\y\", a: \"q\"}").parse();
+    quests::unescapeStrings(values);
+    const snbt::Compound& unescaped = values.as<snbt::Compound>();
+    const bool once = unescaped.size() == 2 && unescaped.count("b") && unescaped.at("b").as<snbt::String>() == "x\\\\y";
+
+    bool reported = false;
+    snbt::Tag twice = snbt::Parser("{\"\\u0061\": 1, a: 2}").parse();
+    try
+    {
+        quests::unescapeStrings(twice);
+    }
+    catch(const std::runtime_error&)
+    {
+        reported = true;
+    }
+    std::printf("escaped keys: %s\n", once && reported ? "ok" : "FAILED");
+    return once && reported;
+}
+
+//Usage: export_bench [chapters] [quests per chapter] [max threads] [durable 0/1]
+int main(int argc, char** argv)
+{
+    const size_t chapters = argc > 1 ? std::stoul(argv[1]) : 60;
+    const size_t quests_per_chapter = argc > 2 ? std::stoul(argv[2]) : 170;
+    const unsigned max_threads = argc > 3 ? std::stoul(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+    const bool durable = argc > 4 ? std::stoul(argv[4]) != 0 : true;
+
+    if(!checkEscapedKeys()) return 1;
+
+    chapter_group pack;
+    makePack(pack, chapters, quests_per_chapter, chapters / 4);
+    const size_t files = pack.getChapters().size() + pack.getRewardTables().size() + 1;
+
+    const std::filesystem::path root = std::filesystem::temp_directory_path() / "questimakinator_export_bench";
+    std::filesystem::remove_all(root);
+
+    std::vector<unsigned> thread_counts;
+    for(unsigned threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    std::printf("pack: %zu chapters, %zu quests, %zu files, %s\n", pack.getChapters().size(),
+                pack.getStore().allQuests().size(), files, durable ? "fsync" : "no fsync");
+
+    //serializing alone, every chapter into the same buffer
+    {
+        std::string buffer;
+        size_t bytes = 0;
+        constexpr int rounds = 5;
+        const auto start = std::chrono::steady_clock::now();
+        for(int round = 0; round < rounds; round++)
+        {
+            for(const chapter& c : pack.getChapters())
+            {
+                buffer.clear();
+                c.writeQuestText(buffer, pack.getStore());
+                bytes += buffer.size();
+            }
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("serialize: %8.2f ms  %10.0f quests/s  %8.1f MB/s\n", seconds * 1e3 / rounds,
+                    pack.getStore().allQuests().size() * rounds / seconds, bytes / seconds / 1e6);
+    }
+
+    for(unsigned threads : thread_counts)
+    {
+        utils::thread_pool pool(threads);
+        pack.generateData(root, pool, durable); //warm up
+        std::filesystem::remove_all(root); //unchanged files aren't written again, every run starts empty
+
+        const auto start = std::chrono::steady_clock::now();
+        const std::string errors = pack.generateData(root, pool, durable);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const size_t left = leftovers(root);
+        std::printf("threads: %2u  %8.2f ms  %8.0f files/s  %8.0f quests/s  %s\n", threads, seconds * 1e3, files / seconds,
+                    pack.getStore().allQuests().size() / seconds, errors.empty() && left == 0 ? "ok" : "FAILED");
+        if(!errors.empty() || left != 0)
+        {
+            std::fprintf(stderr, "%s%zu temp files left\n", errors.c_str(), left);
+            return 1;
+        }
+    }
+
+    //incremental exports: nothing changed, one quest changed, one quest touched but left as it was
+    {
+        utils::thread_pool pool(max_threads);
+        quest_store& store = pack.getStore();
+        const quest_handle edited = store.allQuests().handleAt(store.allQuests().size() / 2);
+        struct step
+        {
+            const char* name;
+            size_t serialized;
+            size_t written;
+        };
+        for(const step& s : {step{"nothing", 0, 0}, step{"one quest", 1, 1}, step{"untouched", 1, 0}})
+        {
+            if(s.serialized != 0)
+            {
+                quest* q = store.getQuest(edited);
+                if(s.written != 0) q->title += "!";
+            }
+            const auto start = std::chrono::steady_clock::now();
+            const std::string errors = pack.generateData(root, pool, durable);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            const bool expected = errors.empty() && pack.lastSerialized() == s.serialized && pack.lastWritten() == s.written;
+            std::printf("changed: %-9s  %8.3f ms  %zu serialized  %zu written  %s\n", s.name, seconds * 1e3,
+                        pack.lastSerialized(), pack.lastWritten(), expected ? "ok" : "FAILED");
+            if(!expected)
+            {
+                std::fprintf(stderr, "%sexpected %zu serialized and %zu written\n", errors.c_str(), s.serialized, s.written);
+                return 1;
+            }
+        }
+
+        //a removed table and a renamed chapter can't leave their old files, the import below would read them back
+        const reward_handle table = store.allRewardTables().handleAt(0);
+        const std::filesystem::path table_file = root / "reward_tables" / (store.getRewardTable(table)->id + ".snbt");
+        store.removeRewardTable(table);
+        chapter* renamed = store.getChapter(store.allChapters().handleAt(1));
+        const std::filesystem::path chapter_file = root / "chapters" / (renamed->fileName() + ".snbt");
+        renamed->changeFileName(renamed->fileName() + "_renamed");
+
+        const auto start = std::chrono::steady_clock::now();
+        const std::string errors = pack.generateData(root, pool, durable);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const bool removed = errors.empty() && pack.lastWritten() == 1 && pack.lastRemoved() == 2 &&
+                             !std::filesystem::exists(table_file) && !std::filesystem::exists(chapter_file);
+        std::printf("changed: %-9s  %8.3f ms  %zu written  %zu removed  %s\n", "removed", seconds * 1e3, pack.lastWritten(),
+                    pack.lastRemoved(), removed ? "ok" : "FAILED");
+        if(!removed)
+        {
+            std::fprintf(stderr, "%sexpected 1 written and the old table and chapter files removed\n", errors.c_str());
+            return 1;
+        }
+    }
+
+    //loading what was just written, writing it again has to give the same files
+    {
+        utils::thread_pool pool(max_threads);
+        chapter_group imported;
+        const auto start = std::chrono::steady_clock::now();
+        const std::string errors = imported.loadData(root, pool);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const quest_store& loaded = imported.getStore();
+        const bool same = errors.empty() && loaded.allQuests().size() == pack.getStore().allQuests().size() &&
+                          loaded.graph().edgeCount() == pack.getStore().graph().edgeCount() && mismatches(imported, root) == 0;
+        std::printf("import:  %8.2f ms  %8.0f files/s  %8.0f quests/s  %zu dependencies  %s\n", seconds * 1e3, files / seconds,
+                    loaded.allQuests().size() / seconds, loaded.graph().edgeCount(), same ? "ok" : "FAILED");
+        if(!same)
+        {
+            std::fprintf(stderr, "%sthe imported pack doesn't write the same files\n", errors.c_str());
+            return 1;
+        }
+
+        //what was imported is on disk already
+        imported.generateData(root, pool, durable);
+        if(imported.lastWritten() != 0)
+        {
+            std::fprintf(stderr, "exporting the imported pack wrote %zu files\n", imported.lastWritten());
+            return 1;
+        }
+    }
+    std::filesystem::remove_all(root);
+    return 0;
+}
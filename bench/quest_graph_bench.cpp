@@ -0,0 +1,206 @@
+#include <quests/quest_graph.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+//FTB-like id: 16 upper case hex characters
+static std::string makeId(std::mt19937_64& gen)
+{
+    static constexpr char digits[] = "0123456789ABCDEF";
+    std::string id(16, '0');
+    for(char& c : id) c = digits[gen() % 16];
+    return id;
+}
+
+/**
+ * @brief Dependencies as a pack has them: most go from a quest to a later one of the progression
+ * (quest i is the i-th of it), one in a hundred is random and may close a loop
+ */
+static std::vector<std::pair<uint32_t, uint32_t>> makeEdges(size_t quests, size_t count, std::mt19937_64& gen)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    edges.reserve(count);
+    while(edges.size() < count)
+    {
+        uint32_t a = static_cast<uint32_t>(gen() % quests);
+        uint32_t b = static_cast<uint32_t>(gen() % quests);
+        if(a == b) continue;
+        if(gen() % 100 != 0)
+        {
+            if(a > b) std::swap(a, b);
+            //mostly close in the order, like the quests of one chapter
+            if(b - a > 64 && gen() % 4 != 0) b = a + 1 + static_cast<uint32_t>(gen() % 64);
+            if(b >= quests) continue;
+        }
+        edges.emplace_back(a, b);
+    }
+    return edges;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Adds the quests in creation order then every dependency (one by one, or with addEdges when batch),
+ * false if the order it ends with is wrong. accepted gets what every addition returned
+ */
+static bool run(const char* name, const std::vector<std::string>& ids, const std::vector<std::pair<uint32_t, uint32_t>>& edges,
+                const std::vector<uint32_t>& creation, size_t prefix, bool batch, std::vector<bool>& accepted)
+{
+    quest_graph graph;
+    graph.reserve(ids.size());
+    std::vector<quest_graph::node> node_of(ids.size());
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t quest : creation) node_of[quest] = graph.addNode(ids[quest]);
+    const double add_nodes = secondsSince(start);
+
+    std::vector<std::pair<quest_graph::node, quest_graph::node>> list;
+    list.reserve(edges.size());
+    for(const auto& [from, to] : edges) list.emplace_back(node_of[from], node_of[to]);
+
+    accepted.assign(edges.size(), false);
+    double prefix_seconds = 0;
+    start = std::chrono::steady_clock::now();
+    if(batch)
+    {
+        const auto results = graph.addEdges(list);
+        for(size_t i = 0; i < results.size(); i++) accepted[i] = results[i] != quest_graph::edge_result::LOOP;
+        prefix = 0;
+    }
+    else
+    {
+        for(size_t i = 0; i < list.size(); i++)
+        {
+            accepted[i] = graph.addEdge(list[i].first, list[i].second);
+            if(i + 1 == prefix) prefix_seconds = secondsSince(start);
+        }
+    }
+    const double add_edges = secondsSince(start);
+    const size_t added = static_cast<size_t>(std::count(accepted.begin(), accepted.end(), true));
+    const size_t rejected = accepted.size() - added;
+
+    //the order has to be a real topological order
+    for(quest_graph::node n = 0; n < graph.size(); n++)
+    {
+        for(quest_graph::node next : graph.dependents(n))
+        {
+            if(graph.position(n) >= graph.position(next))
+            {
+                std::fprintf(stderr, "order broken: %s -> %s\n", graph.idOf(n).c_str(), graph.idOf(next).c_str());
+                return false;
+            }
+        }
+    }
+
+    std::printf("quest_graph, %s: %zu quests, %zu dependencies (%zu rejected as loops)\n", name, graph.size(), added, rejected);
+    std::printf("  nodes  %10.3f ms\n", add_nodes * 1e3);
+    std::printf("  edges  %10.3f ms  %8.1f ns/edge\n", add_edges * 1e3, add_edges * 1e9 / static_cast<double>(edges.size()));
+    if(prefix)
+    {
+        std::printf("  first %zu %7.3f ms  %8.1f ns/edge\n", prefix, prefix_seconds * 1e3,
+                    prefix_seconds * 1e9 / static_cast<double>(prefix));
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    size_t quests = 10000;
+    size_t dependencies = 50000;
+    size_t legacy = 20000; //edges also added searching the graph every time, all 50k take seconds
+
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string_view arg = argv[i];
+        if(arg == "--quests") quests = std::strtoul(argv[i + 1], nullptr, 10);
+        else if(arg == "--deps") dependencies = std::strtoul(argv[i + 1], nullptr, 10);
+        else if(arg == "--legacy") legacy = std::strtoul(argv[i + 1], nullptr, 10);
+        else
+        {
+            std::fputs("Usage: quest_graph_bench [--quests <n>] [--deps <n>] [--legacy <n>]\n", stderr);
+            return 2;
+        }
+    }
+    if(quests < 2)
+    {
+        std::fputs("Needs at least 2 quests\n", stderr);
+        return 2;
+    }
+
+    std::mt19937_64 gen(44);
+    std::vector<std::string> ids;
+    ids.reserve(quests);
+    for(size_t i = 0; i < quests; i++) ids.push_back(makeId(gen));
+    const auto edges = makeEdges(quests, dependencies, gen);
+
+    //quests created in progression order (like an editor or an import does) and in a random one,
+    //the second moves much more of the order around
+    if(legacy > edges.size()) legacy = edges.size();
+    std::vector<uint32_t> creation(quests);
+    for(size_t i = 0; i < quests; i++) creation[i] = static_cast<uint32_t>(i);
+    std::vector<bool> one_by_one, batch;
+    if(!run("progression", ids, edges, creation, legacy, false, one_by_one)) return 1;
+    for(size_t i = quests - 1; i > 0; i--) std::swap(creation[i], creation[gen() % (i + 1)]);
+    if(!run("shuffled", ids, edges, creation, legacy, false, one_by_one)) return 1;
+    //addEdges has to refuse the same dependencies, loops make it add most of them one by one again
+    if(!run("shuffled, addEdges", ids, edges, creation, legacy, true, batch)) return 1;
+    if(batch != one_by_one)
+    {
+        std::fputs("addEdges doesn't refuse the same dependencies as addEdge\n", stderr);
+        return 1;
+    }
+
+    //an import: a pack on disk has no loops, the dependencies come in the order of the files
+    std::vector<std::pair<uint32_t, uint32_t>> pack;
+    for(size_t i = 0; i < edges.size(); i++)
+    {
+        if(one_by_one[i]) pack.push_back(edges[i]);
+    }
+    if(!run("import", ids, pack, creation, 0, false, one_by_one)) return 1;
+    if(!run("import, addEdges", ids, pack, creation, 0, true, batch)) return 1;
+
+    //what quest::addConnection did before quest_graph: search what the new dependency leads to on every edge
+    if(legacy == 0) return 0;
+    std::vector<std::vector<uint32_t>> linked(quests);
+    std::unordered_set<uint32_t> visited;
+    std::vector<uint32_t> stack;
+    auto reaches = [&](uint32_t from, uint32_t target) {
+        visited.clear();
+        stack.assign(1, from);
+        while(!stack.empty())
+        {
+            const uint32_t current = stack.back();
+            stack.pop_back();
+            if(current == target) return true;
+            for(uint32_t next : linked[current])
+            {
+                if(visited.insert(next).second) stack.push_back(next);
+            }
+        }
+        return false;
+    };
+
+    size_t legacy_added = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < legacy; i++)
+    {
+        const auto& [from, to] = edges[i];
+        if(std::find(linked[from].begin(), linked[from].end(), to) != linked[from].end() || reaches(to, from)) continue;
+        linked[from].push_back(to);
+        legacy_added++;
+    }
+    const double legacy_seconds = secondsSince(start);
+
+    std::printf("search per edge: first %zu dependencies (%zu added)\n", legacy, legacy_added);
+    std::printf("  edges  %10.3f ms  %8.1f ns/edge\n", legacy_seconds * 1e3, legacy_seconds * 1e9 / static_cast<double>(legacy));
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include <quests/chapter.h>
+#include <quests/quest_store.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Every allocation keeps its size in front of it, so the live bytes of the program are known
+static size_t live_bytes = 0;
+static size_t allocations = 0;
+static constexpr size_t HEADER = 16;
+
+void* operator new(size_t size)
+{
+    auto* block = static_cast<unsigned char*>(std::malloc(size + HEADER));
+    if(!block) throw std::bad_alloc();
+    std::memcpy(block, &size, sizeof(size));
+    live_bytes += size;
+    allocations++;
+    return block + HEADER;
+}
+
+//Out of line so the optimizer never sees free() on a pointer from operator new
+[[gnu::noinline]] static void release(void* p) noexcept
+{
+    if(!p) return;
+    auto* block = static_cast<unsigned char*>(p) - HEADER;
+    size_t size;
+    std::memcpy(&size, block, sizeof(size));
+    live_bytes -= size;
+    std::free(block);
+}
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+
+static std::string makeId(std::mt19937_64& gen)
+{
+    static constexpr char digits[] = "0123456789ABCDEF";
+    std::string id(16, '0');
+    for(char& c : id) c = digits[gen() % 16];
+    return id;
+}
+
+//A quest the size of a real one: a description, two item tasks and a reward
+static quest makeQuest(std::mt19937_64& gen)
+{
+    quest q;
+    q.id = makeId(gen);
+    q.title = "Collect the ingots of the smelter";
+    q.description = {"Smelt some iron in the furnace, then bring the ingots back.",
+                     "The blacksmith of the village pays well for them.", "&aReward: &ediamonds"};
+    q.position = {static_cast<double>(gen() % 40), static_cast<double>(gen() % 40)};
+    for(int t = 0; t < 2; t++)
+    {
+        snbt::Compound task;
+        task["id"] = snbt::Tag(makeId(gen));
+        task["type"] = snbt::Tag(std::string("item"));
+        task["count"] = snbt::Tag(snbt::Long(16));
+        q.tasks.emplace_back(std::move(task));
+    }
+    reward r;
+    r.id = makeId(gen);
+    r.item_id = "minecraft:diamond";
+    r.count = 4;
+    q.rewards.push_back(std::move(r));
+    return q;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    size_t chapter_count = 50;
+    size_t quests_per_chapter = 200;
+    size_t edits = 100000;
+
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string_view arg = argv[i];
+        if(arg == "--chapters") chapter_count = std::strtoul(argv[i + 1], nullptr, 10);
+        else if(arg == "--quests") quests_per_chapter = std::strtoul(argv[i + 1], nullptr, 10);
+        else if(arg == "--edits") edits = std::strtoul(argv[i + 1], nullptr, 10);
+        else
+        {
+            std::fputs("Usage: quest_store_bench [--chapters <n>] [--quests <per chapter>] [--edits <n>]\n", stderr);
+            return 2;
+        }
+    }
+    if(chapter_count == 0 || quests_per_chapter < 2)
+    {
+        std::fputs("Needs a chapter and 2 quests per chapter\n", stderr);
+        return 2;
+    }
+
+    std::mt19937_64 gen(46);
+    const size_t before = live_bytes;
+    quest_store store;
+    store.reserve(chapter_count * quests_per_chapter, chapter_count);
+
+    //the pack: chapters of quests, each one needs up to 3 earlier quests of its chapter
+    auto start = std::chrono::steady_clock::now();
+    std::vector<chapter_handle> chapters;
+    std::vector<quest_handle> handles;
+    for(size_t c = 0; c < chapter_count; c++)
+    {
+        chapters.push_back(store.addChapter(chapter()));
+        const size_t first = handles.size();
+        for(size_t i = 0; i < quests_per_chapter; i++)
+        {
+            handles.push_back(store.addQuest(chapters.back(), makeQuest(gen)));
+            for(size_t d = 0; i > 0 && d < 3; d++)
+            {
+                store.link(handles[first + gen() % i], handles.back());
+            }
+        }
+    }
+    const double build_seconds = secondsSince(start);
+    const size_t pack_bytes = live_bytes - before;
+    std::printf("pack: %zu chapters, %zu quests, %zu dependencies\n", store.allChapters().size(), store.allQuests().size(),
+                store.graph().edgeCount());
+    std::printf("  build  %10.3f ms  %8.2f MiB live\n", build_seconds * 1e3, pack_bytes / 1048576.0);
+
+    //what getChapters() by value cost on every call
+    start = std::chrono::steady_clock::now();
+    size_t copy_bytes = live_bytes;
+    {
+        quests::slot_map<quest> copy = store.allQuests();
+        copy_bytes = live_bytes - copy_bytes;
+    }
+    std::printf("  copying every quest %8.3f ms  %8.2f MiB\n", secondsSince(start) * 1e3, copy_bytes / 1048576.0);
+
+    //editing: lookups by handle, renames, moves between chapters, new and removed quests, dependencies
+    size_t stale = 0;
+    size_t failed = 0;
+    std::vector<quest_handle> removed;
+    const size_t allocations_before = allocations;
+    start = std::chrono::steady_clock::now();
+    for(size_t e = 0; e < edits; e++)
+    {
+        quest_handle& h = handles[gen() % handles.size()];
+        switch(gen() % 8)
+        {
+            case 0:
+            case 1:
+            case 2:
+                if(quest* q = store.getQuest(h)) q->position.x += 1;
+                else stale++;
+                break;
+            case 3:
+                if(quest* q = store.getQuest(h)) q->title[0] = static_cast<char>('A' + gen() % 26);
+                else stale++;
+                break;
+            case 4:
+                if(!store.moveQuest(h, chapters[gen() % chapters.size()])) failed++;
+                break;
+            case 5:
+            {
+                //the old handle has to stop resolving, the new quest takes the slot
+                const chapter_handle owner = store.chapterOf(h);
+                removed.push_back(h);
+                store.removeQuest(h);
+                h = store.addQuest(owner, makeQuest(gen));
+                break;
+            }
+            case 6:
+                store.link(handles[gen() % handles.size()], h);
+                break;
+            case 7:
+            {
+                const quest* q = store.getQuest(h);
+                if(q && !q->linked_nodes.empty()) store.unlink(h, q->linked_nodes.front().node_linked);
+                break;
+            }
+        }
+    }
+    const double edit_seconds = secondsSince(start);
+    for(quest_handle h : removed)
+    {
+        if(store.getQuest(h)) stale++;
+    }
+
+    std::printf("edits: %zu (%zu removed and added again)\n", edits, removed.size());
+    std::printf("  time   %10.3f ms  %8.1f ns/edit  %6.2f allocations/edit\n", edit_seconds * 1e3,
+                edit_seconds * 1e9 / static_cast<double>(edits),
+                static_cast<double>(allocations - allocations_before) / static_cast<double>(edits));
+    std::printf("  pack after %8.2f MiB live\n", (live_bytes - before) / 1048576.0);
+    if(stale || failed)
+    {
+        std::fprintf(stderr, "%zu handles resolved after their quest was removed, %zu moves failed\n", stale, failed);
+        return 1;
+    }
+    return 0;
+}
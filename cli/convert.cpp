@@ -0,0 +1,459 @@
+#include <parser/batch.h>
+#include <parser/cache.h>
+#include <parser/effects.h>
+#include <parser/lang.h>
+#include <parser/layout.h>
+#include <parser/raw.h>
+#include <parser/reverse.h>
+#include <parser/stream.h>
+#include <utils/thread_pool.h>
+#include <utils/utf8.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Inputs held in memory at once, whatever is reached first
+constexpr size_t BATCH_LINES = 4096;
+constexpr size_t BATCH_BYTES = 8 << 20;
+
+struct Settings
+{
+    raw::Options options;
+    bool reverse = false;
+    bool check = false;
+    bool stream = false;
+    std::string lang_file;
+    std::string lang_prefix;
+    bool json_lines = false;
+    unsigned threads = 0;
+    size_t cache_mib = 0;
+    int fit_width = 0; //0 = texts are left as they are
+    size_t page_lines = 0;
+    std::string output;
+    std::vector<std::string> inputs;
+};
+
+static void usage(std::FILE* to)
+{
+    std::fputs(
+        "Usage: questimakinator-cli [options] [files...]\n"
+        "Converts & markup to Minecraft JSON text, one input per line.\n"
+        "Reads stdin when no files are given (or with -).\n"
+        "\n"
+        "  -o, --output <file>     Write to a file instead of stdout\n"
+        "  --jsonl                 Inputs and outputs are JSON strings, one per line\n"
+        "  --extra                 Use the extra layout instead of arrays\n"
+        "  --minimize              Minimize the components\n"
+        "  --gradient <mode>       srgb (default), oklab or hsv\n"
+        "  --delta-e <x>           Gradient characters closer than x in color (OKLab * 100)\n"
+        "                          share one, fewer components (default 0, ~2 is hard to notice)\n"
+        "  --reverse               JSON text back to & markup\n"
+        "  --stream                Every file is one text (a lore book...), converted as it's read\n"
+        "                          with bounded memory, always JSON\n"
+        "  --check                 Only check the mod effect tags (<wave>...</wave>), no output\n"
+        "  --lang <file>           Write every different text once to a lang file (en_us.json)\n"
+        "                          and output {key} references instead\n"
+        "  --lang-prefix <prefix>  Start of the lang keys (default: questimakinator.text)\n"
+        "  --fit <px>              Wrap lines to px (200 is FTB's quest panel) before converting\n"
+        "  --page-lines <n>        With --fit, an &@page every n lines\n"
+        "  --cache <MiB>           Convert repeated lines once, keeping up to MiB of results\n"
+        "  -j, --threads <n>       Worker threads (default: all cores)\n"
+        "  -h, --help              Show this\n",
+        to);
+}
+
+static bool parseArgs(int argc, char** argv, Settings& settings)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        auto value = [&]() -> const char* {
+            if(i + 1 >= argc)
+            {
+                std::fprintf(stderr, "Missing value for %s\n", argv[i]);
+                return nullptr;
+            }
+            return argv[++i];
+        };
+
+        if(arg == "-h" || arg == "--help")
+        {
+            usage(stdout);
+            std::exit(0);
+        }
+        else if(arg == "-o" || arg == "--output")
+        {
+            const char* v = value();
+            if(!v) return false;
+            settings.output = v;
+        }
+        else if(arg == "--jsonl") settings.json_lines = true;
+        else if(arg == "--extra") settings.options.use_extra = true;
+        else if(arg == "--minimize") settings.options.minimize = true;
+        else if(arg == "--reverse") settings.reverse = true;
+        else if(arg == "--check") settings.check = true;
+        else if(arg == "--stream") settings.stream = true;
+        else if(arg == "--lang" || arg == "--lang-prefix")
+        {
+            const char* v = value();
+            if(!v) return false;
+            (arg == "--lang" ? settings.lang_file : settings.lang_prefix) = v;
+        }
+        else if(arg == "--gradient")
+        {
+            const char* v = value();
+            if(!v) return false;
+            std::string_view mode = v;
+            if(mode == "srgb") settings.options.gradient = raw::gradient::Mode::SRGB;
+            else if(mode == "oklab") settings.options.gradient = raw::gradient::Mode::OKLAB;
+            else if(mode == "hsv") settings.options.gradient = raw::gradient::Mode::HSV;
+            else
+            {
+                std::fprintf(stderr, "Unknown gradient mode: %s\n", v);
+                return false;
+            }
+        }
+        else if(arg == "--delta-e")
+        {
+            const char* v = value();
+            if(!v) return false;
+            char* end = nullptr;
+            const float delta_e = std::strtof(v, &end);
+            if(end == v || *end != '\0' || !(delta_e >= 0.0f))
+            {
+                std::fprintf(stderr, "Invalid delta E: %s\n", v);
+                return false;
+            }
+            settings.options.delta_e = delta_e;
+        }
+        else if(arg == "--fit")
+        {
+            const char* v = value();
+            if(!v) return false;
+            settings.fit_width = std::atoi(v);
+            if(settings.fit_width <= 0)
+            {
+                std::fprintf(stderr, "Invalid width: %s\n", v);
+                return false;
+            }
+        }
+        else if(arg == "--page-lines")
+        {
+            const char* v = value();
+            if(!v) return false;
+            settings.page_lines = std::strtoul(v, nullptr, 10);
+        }
+        else if(arg == "--cache")
+        {
+            const char* v = value();
+            if(!v) return false;
+            settings.cache_mib = std::strtoul(v, nullptr, 10);
+        }
+        else if(arg == "-j" || arg == "--threads")
+        {
+            const char* v = value();
+            if(!v) return false;
+            settings.threads = static_cast<unsigned>(std::strtoul(v, nullptr, 10));
+        }
+        else if(arg.size() > 1 && arg[0] == '-' && arg != "-")
+        {
+            std::fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return false;
+        }
+        else settings.inputs.emplace_back(arg);
+    }
+    if(settings.inputs.empty()) settings.inputs.emplace_back("-");
+    if(settings.stream && (settings.reverse || settings.check || settings.json_lines || settings.fit_width > 0 ||
+                           !settings.lang_file.empty()))
+    {
+        std::fprintf(stderr, "--stream only works alone, converting to JSON\n");
+        return false;
+    }
+    if(settings.reverse && settings.fit_width > 0)
+    {
+        std::fprintf(stderr, "--fit only works when converting to JSON\n");
+        return false;
+    }
+    if(settings.reverse && !settings.lang_file.empty())
+    {
+        std::fprintf(stderr, "--lang only works when converting to JSON\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Converts one stream, a batch at a time
+ * @return Number of lines that failed
+ */
+static size_t convertStream(std::istream& in, const std::string& name, std::ostream& out,
+                            const Settings& settings, utils::thread_pool& pool, raw::lang::Extractor* lang,
+                            raw::ConversionCache* cache)
+{
+    std::vector<std::string> lines;
+    std::vector<std::string> bad_input; //error of the lines that couldn't even be read
+    std::string line;
+    std::string encoded;
+    std::string reference;
+    size_t line_number = 0;
+    size_t failed = 0;
+
+    auto convert_one = [&](const std::string& input) {
+        if(settings.reverse) return raw::from_json(input);
+        if(settings.fit_width > 0)
+        {
+            raw::layout::Options layout;
+            layout.width = settings.fit_width;
+            layout.lines_per_page = settings.page_lines;
+            layout.gradient = settings.options.gradient;
+            layout.delta_e = settings.options.delta_e;
+            const std::string fitted = raw::layout::fit(input, layout);
+            return cache ? cache->convert(fitted, settings.options) : raw::to_json(fitted, settings.options);
+        }
+        return cache ? cache->convert(input, settings.options) : raw::to_json(input, settings.options);
+    };
+
+    while(in)
+    {
+        lines.clear();
+        bad_input.clear();
+        size_t bytes = 0;
+        const size_t first_line = line_number;
+
+        while(lines.size() < BATCH_LINES && bytes < BATCH_BYTES && std::getline(in, line))
+        {
+            if(!line.empty() && line.back() == '\r') line.pop_back();
+            line_number++;
+            bytes += line.size();
+
+            std::string error;
+            if(settings.json_lines)
+            {
+                try
+                {
+                    raw::reverse::Reader reader(line);
+                    std::string decoded = reader.readString();
+                    if(!reader.atEnd()) throw raw::reverse::ParseError("Unexpected trailing characters");
+                    line = std::move(decoded);
+                }
+                catch(const std::exception& e)
+                {
+                    error = e.what();
+                    line.clear();
+                }
+            }
+            if(error.empty() && !utils::utf8::validate(line))
+            {
+                //still converted, bad bytes are kept as they are
+                std::fprintf(stderr, "%s:%zu: warning: invalid UTF-8\n", name.c_str(), line_number);
+            }
+            lines.push_back(std::move(line));
+            bad_input.push_back(std::move(error));
+        }
+        if(lines.empty()) break;
+
+        if(settings.check)
+        {
+            for(size_t i = 0; i < bad_input.size(); i++)
+            {
+                if(bad_input[i].empty()) continue;
+                std::fprintf(stderr, "%s:%zu: %s\n", name.c_str(), first_line + i + 1, bad_input[i].c_str());
+                failed++;
+            }
+            for(const auto& found : raw::effects::validate(lines, pool))
+            {
+                const size_t input_line = first_line + found.index + 1;
+                for(const auto& issue : found.issues)
+                {
+                    const char* severity = issue.severity == raw::effects::Severity::ERROR ? "error" : "warning";
+                    //a JSON-lines text can have its own lines, those are given apart
+                    if(settings.json_lines)
+                    {
+                        std::fprintf(stderr, "%s:%zu: %s: %s (text %zu:%zu)\n", name.c_str(), input_line, severity,
+                                     issue.message.c_str(), issue.line, issue.column);
+                    }
+                    else
+                    {
+                        std::fprintf(stderr, "%s:%zu:%zu: %s: %s\n", name.c_str(), input_line, issue.column, severity,
+                                     issue.message.c_str());
+                    }
+                    if(issue.severity == raw::effects::Severity::ERROR) failed++;
+                }
+            }
+            continue;
+        }
+
+        raw::batch::Result result = raw::batch::transform(lines, convert_one, pool);
+
+        size_t next_error = 0;
+        for(size_t i = 0; i < result.size(); i++)
+        {
+            const char* message = nullptr;
+            if(!bad_input[i].empty()) message = bad_input[i].c_str();
+            while(next_error < result.errors.size() && result.errors[next_error].index < i) next_error++;
+            if(!message && next_error < result.errors.size() && result.errors[next_error].index == i)
+            {
+                message = result.errors[next_error].message.c_str();
+            }
+            if(message)
+            {
+                std::fprintf(stderr, "%s:%zu: %s\n", name.c_str(), first_line + i + 1, message);
+                failed++;
+            }
+
+            //an empty line keeps the output lined up with the input
+            std::string_view converted = result.at(i);
+            if(lang && !message)
+            {
+                reference = lang->addConverted(converted);
+                converted = reference;
+            }
+
+            if(settings.json_lines)
+            {
+                encoded.clear();
+                encoded += '"';
+                raw::json_escape_to(encoded, converted);
+                encoded += '"';
+                out << encoded << '\n';
+            }
+            else
+            {
+                out << converted << '\n';
+            }
+        }
+    }
+    //getline stops the same way at the end and on a read error, only bad() tells them apart
+    if(in.bad())
+    {
+        std::fprintf(stderr, "%s: error reading the input\n", name.c_str());
+        failed++;
+    }
+    out.flush();
+    return failed;
+}
+
+//Headless converter, no window and no ImGui, meant for scripts
+int main(int argc, char** argv)
+{
+    Settings settings;
+    if(!parseArgs(argc, argv, settings))
+    {
+        usage(stderr);
+        return 2;
+    }
+
+    std::ios::sync_with_stdio(false);
+
+    std::unique_ptr<utils::thread_pool> own_pool;
+    if(settings.threads > 0) own_pool = std::make_unique<utils::thread_pool>(settings.threads);
+    utils::thread_pool& pool = own_pool ? *own_pool : utils::thread_pool::shared();
+
+    std::ofstream file_out;
+    if(!settings.output.empty())
+    {
+        file_out.open(settings.output, std::ios::binary);
+        if(!file_out)
+        {
+            std::fprintf(stderr, "Couldn't open %s for writing\n", settings.output.c_str());
+            return 1;
+        }
+    }
+    std::ostream& out = settings.output.empty() ? std::cout : file_out;
+
+    std::unique_ptr<raw::ConversionCache> cache;
+    if(settings.cache_mib > 0 && !settings.reverse) cache = std::make_unique<raw::ConversionCache>(settings.cache_mib << 20);
+
+    std::ofstream lang_out;
+    std::unique_ptr<raw::lang::Extractor> lang;
+    if(!settings.lang_file.empty())
+    {
+        lang_out.open(settings.lang_file, std::ios::binary);
+        if(!lang_out)
+        {
+            std::fprintf(stderr, "Couldn't open %s for writing\n", settings.lang_file.c_str());
+            return 1;
+        }
+        raw::lang::Options lang_options;
+        lang_options.convert = settings.options;
+        if(!settings.lang_prefix.empty()) lang_options.prefix = settings.lang_prefix;
+        lang = std::make_unique<raw::lang::Extractor>(lang_out, lang_options);
+    }
+
+    size_t failed = 0;
+    for(const auto& input : settings.inputs)
+    {
+        if(settings.stream)
+        {
+            std::ifstream file;
+            if(input != "-")
+            {
+                file.open(input, std::ios::binary);
+                if(!file)
+                {
+                    std::fprintf(stderr, "Couldn't open %s\n", input.c_str());
+                    failed++;
+                    continue;
+                }
+            }
+            std::istream& in = input == "-" ? std::cin : file;
+            raw::StreamConverter::convert(in, out, settings.options);
+            out << '\n';
+            if(in.bad())
+            {
+                std::fprintf(stderr, "%s: error reading the input\n", input == "-" ? "<stdin>" : input.c_str());
+                failed++;
+            }
+            continue;
+        }
+
+        if(input == "-")
+        {
+            failed += convertStream(std::cin, "<stdin>", out, settings, pool, lang.get(), cache.get());
+            continue;
+        }
+
+        std::ifstream file(input, std::ios::binary);
+        if(!file)
+        {
+            std::fprintf(stderr, "Couldn't open %s\n", input.c_str());
+            failed++;
+            continue;
+        }
+        failed += convertStream(file, input, out, settings, pool, lang.get(), cache.get());
+    }
+
+    if(cache)
+    {
+        const auto stats = cache->stats();
+        std::fprintf(stderr, "cache: %zu hits, %zu misses (%.1f%%), %zu evictions, %zu entries in %zu bytes\n",
+                     stats.hits, stats.misses, stats.hitRate() * 100.0, stats.evictions, stats.entries, stats.bytes);
+    }
+
+    if(lang)
+    {
+        const raw::lang::Report& report = lang->finish();
+        std::fprintf(stderr, "%zu texts, %zu different (%zu duplicates)\n", report.texts, report.unique, report.duplicates());
+        std::fprintf(stderr, "inline %zu bytes -> %zu bytes of references + %zu bytes of lang (%lld saved)\n",
+                     report.inline_bytes, report.reference_bytes, report.lang_bytes, report.bytesSaved());
+        if(!lang_out)
+        {
+            std::fprintf(stderr, "Error writing %s\n", settings.lang_file.c_str());
+            return 1;
+        }
+    }
+
+    if(!out)
+    {
+        std::fprintf(stderr, "Error writing the output\n");
+        return 1;
+    }
+    return failed ? 1 : 0;
+}
@@ -1,17 +1,26 @@
 #ifndef BASIC_HEADER_FILES_H
 #define BASIC_HEADER_FILES_H
 
+#include <string_view>
+
 enum class team_reward {DEFAULT, ENABLED, DISABLED};
 enum class auto_claim {DEFAULT, DISABLED, ENABLED, DISABLED_TOAST, ENABLED_TOAST};
 
+//FTB keeps quest positions as doubles, halves and smaller steps are common
 struct vec2
 {
-    int x;
-    int y;
+    double x;
+    double y;
 };
 
 enum class Shapes {DEFAULT, CIRCLE, SQUARE, ROUNDED_SQUARE, DIAMOND, PENTAGON, HEXAGON, OCTAGON, HEART, GEAR, NO_SHAPE}; //shape
 enum class Progression {DEFAULT, LINEAR, FLEXIBLE};
 enum class DependecyMode {ALL_COMPLETED, ONE_COMPLETED, ALL_STARTED, ONE_STARTED};
-enum class Hide {DEFAULT, HIDDEN, VISIBLE};
+enum class Hide {DEFAULT, HIDDEN, VISIBLE}; //also FTB's tristates: HIDDEN is true, VISIBLE is false
+
+//Names FTB Quests writes for the enums above, indexed by their value (DEFAULT isn't written)
+inline constexpr std::string_view SHAPE_NAMES[] = {"default", "circle", "square", "rsquare", "diamond", "pentagon",
+                                                   "hexagon", "octagon", "heart", "gear", "none"};
+inline constexpr std::string_view PROGRESSION_NAMES[] = {"default", "linear", "flexible"};
+inline constexpr std::string_view DEPENDENCY_MODE_NAMES[] = {"all_completed", "one_completed", "all_started", "one_started"};
 #endif
\ No newline at end of file
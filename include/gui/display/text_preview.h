@@ -0,0 +1,63 @@
+#pragma once
+
+#include <imgui.h>
+#include <parser/gradient.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Shows converted text the way Minecraft draws it: colors, bold, italic, underline,
+ * strikethrough, shadow_color and obfuscated characters, wrapped to FTB's quest panel
+ * Glyphs come from ImGui's font atlas and are placed with Minecraft's advances (raw::layout)
+ * The vertices are built once per text and copied into the draw list every frame,
+ * only obfuscated characters are drawn again (they change every frame)
+ */
+class TextPreview {
+public:
+    void draw(const std::string& markup, raw::gradient::Mode mode, float delta_e, float height);
+
+private:
+    enum Flags : uint8_t {
+        BOLD = 1,
+        ITALIC = 2,
+        UNDERLINED = 4,
+        STRIKETHROUGH = 8,
+        OBFUSCATED = 16
+    };
+
+    struct Glyph {
+        float x, y; // top left inside the preview
+        ImWchar c;
+        uint8_t flags;
+        uint8_t advance; // Minecraft pixels, bold included
+        ImU32 color;
+        ImU32 shadow; // 0 = none
+    };
+
+    struct Rule {
+        ImVec2 from, to;
+        ImU32 color;
+    };
+
+    uint64_t source_key = 0;
+    float pixel = 0.0f; // screen pixels per Minecraft pixel
+    std::vector<Glyph> glyphs;
+    std::vector<Rule> rules; // underlines, strikethroughs and page breaks
+    std::vector<size_t> obfuscated; // glyphs drawn every frame
+    ImVec2 content_size;
+
+    // vertices of everything but the obfuscated glyphs, relative to the preview's corner
+    std::vector<ImDrawVert> vertices;
+    std::vector<ImDrawIdx> indices;
+    bool captured = false;
+    ImVec2 atlas_white; // moves when the font atlas is built again
+    uint32_t random_state = 0x9E3779B9u;
+
+    void layout(const std::string& markup, raw::gradient::Mode mode, float delta_e);
+    void drawGlyph(ImDrawList* draw_list, const Glyph& glyph, ImVec2 origin, ImWchar c) const;
+    void drawStatic(ImDrawList* draw_list, ImVec2 origin);
+    void emitCached(ImDrawList* draw_list, ImVec2 origin) const;
+    ImWchar randomGlyph(uint8_t advance);
+};
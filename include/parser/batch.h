@@ -0,0 +1,115 @@
+#ifndef RAW_BATCH_HPP
+#define RAW_BATCH_HPP
+
+#include <cstddef>
+#include <exception>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <parser/raw.h>
+#include <utils/thread_pool.h>
+
+namespace raw
+{
+namespace batch
+{
+    //Items per job, small enough to balance, big enough to not fight over the counter
+    constexpr size_t CHUNK_SIZE = 64;
+
+    struct Error
+    {
+        size_t index; //position of the input that failed
+        std::string message;
+    };
+
+    /**
+     * @brief Output of a batch conversion
+     * Every result lives in the same arena, item i is arena[offsets[i], offsets[i + 1])
+     * Failed items are empty and listed in errors (sorted by index)
+     */
+    struct Result
+    {
+        std::string arena;
+        std::vector<size_t> offsets;
+        std::vector<Error> errors;
+
+        size_t size() const
+        {
+            return offsets.empty() ? 0 : offsets.size() - 1;
+        }
+
+        std::string_view at(size_t index) const
+        {
+            return std::string_view(arena).substr(offsets[index], offsets[index + 1] - offsets[index]);
+        }
+    };
+
+    /**
+     * @brief Runs convert_one(input) over every input on the pool
+     * The output order is the input order no matter how many threads are used
+     */
+    template<class Convert>
+    inline Result transform(std::span<const std::string> inputs,
+                            Convert&& convert_one,
+                            utils::thread_pool& pool = utils::thread_pool::shared())
+    {
+        struct Chunk
+        {
+            std::string text;
+            std::vector<size_t> ends; //end of each item inside text
+            std::vector<Error> errors;
+        };
+
+        const size_t chunk_count = (inputs.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        std::vector<Chunk> chunks(chunk_count);
+
+        pool.parallel_for(inputs.size(), CHUNK_SIZE, [&](size_t begin, size_t end) {
+            Chunk& chunk = chunks[begin / CHUNK_SIZE];
+            chunk.ends.reserve(end - begin);
+            for(size_t i = begin; i < end; i++)
+            {
+                try
+                {
+                    chunk.text += convert_one(inputs[i]);
+                }
+                catch(const std::exception& e)
+                {
+                    chunk.errors.push_back({i, e.what()});
+                }
+                catch(...)
+                {
+                    chunk.errors.push_back({i, "unknown error"});
+                }
+                chunk.ends.push_back(chunk.text.size());
+            }
+        });
+
+        Result result;
+        size_t total = 0;
+        for(const auto& chunk : chunks) total += chunk.text.size();
+        result.arena.reserve(total);
+        result.offsets.reserve(inputs.size() + 1);
+        result.offsets.push_back(0);
+
+        for(auto& chunk : chunks)
+        {
+            const size_t base = result.arena.size();
+            result.arena += chunk.text;
+            for(size_t end : chunk.ends) result.offsets.push_back(base + end);
+            for(auto& error : chunk.errors) result.errors.push_back(std::move(error));
+        }
+        return result;
+    }
+
+    //to_json over every input
+    inline Result convert(std::span<const std::string> inputs,
+                          const Options& options = {},
+                          utils::thread_pool& pool = utils::thread_pool::shared())
+    {
+        return transform(inputs, [&](const std::string& input) { return to_json(input, options); }, pool);
+    }
+}
+}
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef RAW_CACHE_HPP
+#define RAW_CACHE_HPP
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <parser/batch.h>
+#include <parser/raw.h>
+#include <utils/hash.h>
+#include <utils/thread_pool.h>
+
+namespace raw
+{
+    /**
+     * @brief to_json with memory: the same text with the same options is converted once
+     * Entries are keyed by a 64 bit hash of (input, options, CONVERTER_VERSION), a second hash
+     * of the input tells apart the rare collision. The input itself isn't kept
+     * Least recently used results go first once the memory budget is reached
+     * Thread safe, the entries are split in shards with a lock each so batch workers rarely wait
+     */
+    class ConversionCache
+    {
+    public:
+        struct Stats
+        {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t evictions = 0;
+            size_t entries = 0;
+            size_t bytes = 0; //charged to the budget, results plus bookkeeping
+
+            double hitRate() const
+            {
+                const size_t total = hits + misses;
+                return total ? static_cast<double>(hits) / total : 0.0;
+            }
+        };
+
+        static constexpr size_t DEFAULT_BUDGET = 32 << 20;
+
+    private:
+        static constexpr size_t SHARDS = 16; //power of 2
+        //list node, map node and the result's own header, roughly
+        static constexpr size_t ENTRY_OVERHEAD = 128;
+
+        struct Entry
+        {
+            uint64_t key;
+            uint64_t check;
+            std::string output;
+            Report report;
+            bool has_report;
+            size_t charge;
+        };
+
+        struct Shard
+        {
+            std::mutex mutex;
+            std::list<Entry> order; //most recently used first
+            std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+            size_t bytes = 0;
+        };
+
+        Shard shards_[SHARDS];
+        size_t shard_budget_;
+        std::atomic<size_t> hits_ = 0;
+        std::atomic<size_t> misses_ = 0;
+        std::atomic<size_t> evictions_ = 0;
+
+        static uint64_t optionsKey(const Options& options)
+        {
+            uint64_t bits = (options.use_extra ? 1 : 0) | (options.minimize ? 2 : 0) |
+                            (static_cast<uint64_t>(options.gradient) << 2);
+            uint64_t h = utils::combine(CONVERTER_VERSION, bits);
+            return utils::combine(h, std::bit_cast<uint32_t>(options.delta_e));
+        }
+
+        Shard& shardOf(uint64_t key)
+        {
+            return shards_[key >> 60 & (SHARDS - 1)];
+        }
+
+        //True and output (and report) filled when found
+        bool find(uint64_t key, uint64_t check, std::string& output, Report* report)
+        {
+            Shard& shard = shardOf(key);
+            std::lock_guard lock(shard.mutex);
+            auto it = shard.index.find(key);
+            if(it == shard.index.end()) return false;
+            Entry& entry = *it->second;
+            if(entry.check != check || (report && !entry.has_report)) return false;
+
+            shard.order.splice(shard.order.begin(), shard.order, it->second);
+            output = entry.output;
+            if(report) *report = entry.report;
+            return true;
+        }
+
+        void store(uint64_t key, uint64_t check, const std::string& output, const Report* report)
+        {
+            const size_t charge = output.size() + ENTRY_OVERHEAD;
+            if(charge > shard_budget_) return;
+
+            Shard& shard = shardOf(key);
+            std::lock_guard lock(shard.mutex);
+            auto it = shard.index.find(key);
+            if(it != shard.index.end())
+            {
+                //other thread got here first, or a collision: the newest one stays
+                shard.bytes -= it->second->charge;
+                shard.order.erase(it->second);
+                shard.index.erase(it);
+            }
+
+            shard.order.push_front({key, check, output, report ? *report : Report{}, report != nullptr, charge});
+            shard.index.emplace(key, shard.order.begin());
+            shard.bytes += charge;
+
+            while(shard.bytes > shard_budget_)
+            {
+                const Entry& last = shard.order.back();
+                shard.bytes -= last.charge;
+                shard.index.erase(last.key);
+                shard.order.pop_back();
+                evictions_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+    public:
+        explicit ConversionCache(size_t budget_bytes = DEFAULT_BUDGET) : shard_budget_(budget_bytes / SHARDS) {}
+
+        ConversionCache(const ConversionCache&) = delete;
+        ConversionCache& operator=(const ConversionCache&) = delete;
+
+        /**
+         * @brief Same as to_json, converting only when the text wasn't seen before
+         * Texts that throw aren't cached, the exception goes through as usual
+         */
+        std::string convert(const std::string& input, const Options& options = {}, Report* report = nullptr)
+        {
+            const uint64_t key = utils::hash64(input, optionsKey(options));
+            const uint64_t check = utils::hash64(input, 0x51ed270b27a1f3c5ULL);
+
+            std::string output;
+            if(find(key, check, output, report))
+            {
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return output;
+            }
+            misses_.fetch_add(1, std::memory_order_relaxed);
+
+            output = to_json(input, options, report);
+            store(key, check, output, report);
+            return output;
+        }
+
+        Stats stats()
+        {
+            Stats stats;
+            stats.hits = hits_.load(std::memory_order_relaxed);
+            stats.misses = misses_.load(std::memory_order_relaxed);
+            stats.evictions = evictions_.load(std::memory_order_relaxed);
+            for(Shard& shard : shards_)
+            {
+                std::lock_guard lock(shard.mutex);
+                stats.entries += shard.order.size();
+                stats.bytes += shard.bytes;
+            }
+            return stats;
+        }
+
+        size_t budget() const
+        {
+            return shard_budget_ * SHARDS;
+        }
+
+        //Drops every entry, the counters are kept
+        void clear()
+        {
+            for(Shard& shard : shards_)
+            {
+                std::lock_guard lock(shard.mutex);
+                shard.order.clear();
+                shard.index.clear();
+                shard.bytes = 0;
+            }
+        }
+    };
+
+namespace batch
+{
+    //convert through a cache, repeated lines are converted once
+    inline Result convert(std::span<const std::string> inputs,
+                          const Options& options,
+                          ConversionCache& cache,
+                          utils::thread_pool& pool = utils::thread_pool::shared())
+    {
+        return transform(inputs, [&](const std::string& input) { return cache.convert(input, options); }, pool);
+    }
+}
+}
+
+#endif
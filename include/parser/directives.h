@@ -0,0 +1,269 @@
+#ifndef RAW_DIRECTIVES_HPP
+#define RAW_DIRECTIVES_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace raw
+{
+/**
+ * Every & command in one table: what it is, if it takes a "value" and what it becomes in JSON
+ * Codes of one letter (&l, &c, &r...) are found with a 256 entry table,
+ * named ones (&@url:"...", &&text:"...") with a perfect hash built at compile time
+ * To add a command, add a line to DIRECTIVES and give it a Kind the parser knows
+ */
+namespace directives
+{
+    enum class Kind : uint8_t
+    {
+        UNKNOWN,    //&@whatever:"..." or &&whatever:"...", eaten without effect
+        RESET,      //&r
+        FORMAT,     //&l &o &n &m &k
+        COLOR,      //&0-&f
+        HEX_COLOR,  //&#RRGGBB
+        CLICK,      //&@url:"..." and friends, applies to the text after it
+        PAGE,       //&@page
+        GRADIENT,   //&@gradient:"...", expanded before parsing
+        HOVER,      //&&text:"..." &&item:"...", applies to the text before it
+        SHADOW      //&&shadow:"#AARRGGBB", applies to the text before it
+    };
+
+    struct Directive
+    {
+        char prefix;            //'@' or '&' for named commands, 0 for one letter codes
+        std::string_view name;  //"url", "l", "0"...
+        Kind kind;
+        bool argument;          //takes :"value"
+        bool non_ftb;           //FTB can't show it, the text has to become JSON
+        std::string_view json;  //click/hover action, format key or color
+        uint8_t index;          //FORMAT: bit in Format, COLOR: color number
+    };
+
+    enum Format : uint8_t { BOLD, ITALIC, UNDERLINED, STRIKETHROUGH, OBFUSCATED };
+
+    inline constexpr std::array DIRECTIVES = {
+        Directive{0, "r", Kind::RESET, false, false, "", 0},
+        Directive{0, "l", Kind::FORMAT, false, false, "bold", BOLD},
+        Directive{0, "o", Kind::FORMAT, false, false, "italic", ITALIC},
+        Directive{0, "n", Kind::FORMAT, false, false, "underlined", UNDERLINED},
+        Directive{0, "m", Kind::FORMAT, false, false, "strikethrough", STRIKETHROUGH},
+        Directive{0, "k", Kind::FORMAT, false, false, "obfuscated", OBFUSCATED},
+        Directive{0, "0", Kind::COLOR, false, false, "#000000", 0},
+        Directive{0, "1", Kind::COLOR, false, false, "#0000AA", 1},
+        Directive{0, "2", Kind::COLOR, false, false, "#00AA00", 2},
+        Directive{0, "3", Kind::COLOR, false, false, "#00AAAA", 3},
+        Directive{0, "4", Kind::COLOR, false, false, "#AA0000", 4},
+        Directive{0, "5", Kind::COLOR, false, false, "#AA00AA", 5},
+        Directive{0, "6", Kind::COLOR, false, false, "#FFAA00", 6},
+        Directive{0, "7", Kind::COLOR, false, false, "#AAAAAA", 7},
+        Directive{0, "8", Kind::COLOR, false, false, "#555555", 8},
+        Directive{0, "9", Kind::COLOR, false, false, "#5555FF", 9},
+        Directive{0, "a", Kind::COLOR, false, false, "#55FF55", 10},
+        Directive{0, "b", Kind::COLOR, false, false, "#55FFFF", 11},
+        Directive{0, "c", Kind::COLOR, false, false, "#FF5555", 12},
+        Directive{0, "d", Kind::COLOR, false, false, "#FF55FF", 13},
+        Directive{0, "e", Kind::COLOR, false, false, "#FFFF55", 14},
+        Directive{0, "f", Kind::COLOR, false, false, "#FFFFFF", 15},
+        Directive{0, "#", Kind::HEX_COLOR, false, false, "", 0},
+        Directive{'@', "url", Kind::CLICK, true, true, "open_url", 0},
+        Directive{'@', "in", Kind::CLICK, true, true, "suggest_command", 0},
+        Directive{'@', "file", Kind::CLICK, true, true, "open_file", 0},
+        Directive{'@', "command", Kind::CLICK, true, true, "run_command", 0},
+        Directive{'@', "copy", Kind::CLICK, true, true, "copy_to_clipboard", 0},
+        Directive{'@', "change", Kind::CLICK, true, true, "change_page", 0},
+        Directive{'@', "page", Kind::PAGE, false, true, "", 0},
+        Directive{'@', "gradient", Kind::GRADIENT, true, false, "", 0},
+        Directive{'&', "text", Kind::HOVER, true, true, "show_text", 0},
+        Directive{'&', "item", Kind::HOVER, true, true, "show_item", 0},
+        Directive{'&', "shadow", Kind::SHADOW, true, true, "shadow_color", 0},
+    };
+
+    //Named commands nobody knows, the prefix still says where they apply
+    inline constexpr Directive UNKNOWN_AT{'@', "", Kind::UNKNOWN, true, false, "", 0};
+    inline constexpr Directive UNKNOWN_AMP{'&', "", Kind::UNKNOWN, true, false, "", 0};
+
+    namespace detail
+    {
+        constexpr size_t SLOTS = 64; //power of 2, a bit over the named commands and actions
+
+        constexpr uint32_t hash(char prefix, std::string_view name, uint32_t seed)
+        {
+            uint32_t h = seed ^ static_cast<uint8_t>(prefix);
+            for(char c : name) h = (h ^ static_cast<uint8_t>(c)) * 0x01000193u;
+            return (h ^ (h >> 15)) & (SLOTS - 1);
+        }
+
+        //Named commands are keyed by prefix + name, actions (for going back from JSON) by json
+        constexpr bool namedKey(const Directive& d) { return d.prefix != 0; }
+        constexpr bool actionKey(const Directive& d) { return d.kind == Kind::CLICK || d.kind == Kind::HOVER; }
+
+        template<bool Action>
+        constexpr uint32_t findSeed()
+        {
+            for(uint32_t seed = 1; seed < 1000000; seed++)
+            {
+                bool used[SLOTS] = {};
+                bool collision = false;
+                for(const auto& d : DIRECTIVES)
+                {
+                    if(Action ? !actionKey(d) : !namedKey(d)) continue;
+                    uint32_t slot = Action ? hash(0, d.json, seed) : hash(d.prefix, d.name, seed);
+                    if(used[slot])
+                    {
+                        collision = true;
+                        break;
+                    }
+                    used[slot] = true;
+                }
+                if(!collision) return seed;
+            }
+            return 0;
+        }
+
+        inline constexpr uint32_t NAMED_SEED = findSeed<false>();
+        inline constexpr uint32_t ACTION_SEED = findSeed<true>();
+        static_assert(NAMED_SEED != 0 && ACTION_SEED != 0, "No perfect hash for the directive table, make SLOTS bigger");
+
+        //Position in DIRECTIVES + 1, 0 is empty
+        template<bool Action>
+        constexpr std::array<uint8_t, SLOTS> buildSlots()
+        {
+            std::array<uint8_t, SLOTS> slots{};
+            for(size_t i = 0; i < DIRECTIVES.size(); i++)
+            {
+                const Directive& d = DIRECTIVES[i];
+                if(Action ? !actionKey(d) : !namedKey(d)) continue;
+                slots[Action ? hash(0, d.json, ACTION_SEED) : hash(d.prefix, d.name, NAMED_SEED)] = static_cast<uint8_t>(i + 1);
+            }
+            return slots;
+        }
+
+        constexpr std::array<uint8_t, 256> buildCodes()
+        {
+            std::array<uint8_t, 256> codes{};
+            for(size_t i = 0; i < DIRECTIVES.size(); i++)
+            {
+                const Directive& d = DIRECTIVES[i];
+                if(d.prefix != 0) continue;
+                codes[static_cast<uint8_t>(d.name[0])] = static_cast<uint8_t>(i + 1);
+                //&A-&F work like &a-&f
+                if(d.kind == Kind::COLOR && d.name[0] >= 'a' && d.name[0] <= 'f')
+                {
+                    codes[static_cast<uint8_t>(d.name[0] - 'a' + 'A')] = static_cast<uint8_t>(i + 1);
+                }
+            }
+            return codes;
+        }
+
+        inline constexpr std::array<uint8_t, SLOTS> NAMED_SLOTS = buildSlots<false>();
+        inline constexpr std::array<uint8_t, SLOTS> ACTION_SLOTS = buildSlots<true>();
+        inline constexpr std::array<uint8_t, 256> CODES = buildCodes();
+
+        constexpr bool nameChar(char c)
+        {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        }
+    }
+
+    //&<code>, nullptr if it isn't one
+    constexpr const Directive* find_code(char code)
+    {
+        uint8_t index = detail::CODES[static_cast<uint8_t>(code)];
+        return index ? &DIRECTIVES[index - 1] : nullptr;
+    }
+
+    //&@name or &&name, nullptr if it isn't one
+    constexpr const Directive* find_named(char prefix, std::string_view name)
+    {
+        uint8_t index = detail::NAMED_SLOTS[detail::hash(prefix, name, detail::NAMED_SEED)];
+        if(!index) return nullptr;
+        const Directive& d = DIRECTIVES[index - 1];
+        return d.prefix == prefix && d.name == name ? &d : nullptr;
+    }
+
+    //Click or hover command of a JSON action ("open_url" -> &@url), nullptr if there's none
+    constexpr const Directive* find_action(std::string_view action)
+    {
+        uint8_t index = detail::ACTION_SLOTS[detail::hash(0, action, detail::ACTION_SEED)];
+        if(!index) return nullptr;
+        const Directive& d = DIRECTIVES[index - 1];
+        return d.json == action ? &d : nullptr;
+    }
+
+    //&0-&f by number
+    constexpr const Directive& color(size_t index)
+    {
+        return DIRECTIVES[detail::CODES[static_cast<uint8_t>('0')] - 1 + index];
+    }
+
+    struct Match
+    {
+        const Directive* directive = nullptr; //nullptr when the & is just text
+        size_t length = 0;                    //characters of the whole command
+        std::string_view argument;            //value between the quotes (or the hex of &#RRGGBB)
+    };
+
+    //What ends a command without value when a letter comes right after it
+    inline constexpr std::string_view BARE_CLOSE = ":\"\"";
+
+    //A command without value written right before text[at] needs BARE_CLOSE after it
+    constexpr bool needs_close(std::string_view text, size_t at)
+    {
+        return at < text.size() && (detail::nameChar(text[at]) || text.substr(at, BARE_CLOSE.size()) == BARE_CLOSE);
+    }
+
+    /**
+     * @brief The command that starts at text[pos] (an '&')
+     * Named commands need :"value" (escaped quotes are skipped), &@page is the only one without it.
+     * Its name ends at the first character that can't be in one (&@pageText is text), an empty value
+     * ends it anywhere: &@page:""Text is the page and "Text" (what the writers put, see needs_close)
+     * Unknown named commands with a value match as UNKNOWN_AT / UNKNOWN_AMP
+     */
+    constexpr Match match(std::string_view text, size_t pos)
+    {
+        if(pos + 1 >= text.size() || text[pos] != '&') return {};
+        const char code = text[pos + 1];
+
+        if(code != '@' && code != '&')
+        {
+            const Directive* d = find_code(code);
+            if(!d) return {};
+            if(d->kind == Kind::HEX_COLOR)
+            {
+                if(pos + 7 >= text.size()) return {};
+                return {d, 8, text.substr(pos + 2, 6)};
+            }
+            return {d, 2, {}};
+        }
+
+        if(pos + 2 >= text.size()) return {};
+        size_t end = pos + 2;
+        while(end < text.size() && detail::nameChar(text[end])) end++;
+        const std::string_view name = text.substr(pos + 2, end - pos - 2);
+        const Directive* d = find_named(code, name);
+
+        if(d && !d->argument)
+        {
+            if(text.substr(end, BARE_CLOSE.size()) == BARE_CLOSE) return {d, end + BARE_CLOSE.size() - pos, {}};
+            return {d, end - pos, {}};
+        }
+
+        //a command without value is only its whole name, &@pageX is text
+        if(end + 1 >= text.size() || text[end] != ':' || text[end + 1] != '"') return {};
+        size_t end_quote = end + 2;
+        while(end_quote < text.size() && text[end_quote] != '"')
+        {
+            if(text[end_quote] == '\\' && end_quote + 1 < text.size()) end_quote++;
+            end_quote++;
+        }
+        if(end_quote >= text.size()) return {};
+
+        if(!d) d = code == '@' ? &UNKNOWN_AT : &UNKNOWN_AMP;
+        return {d, end_quote + 1 - pos, text.substr(end + 2, end_quote - end - 2)};
+    }
+}
+}
+
+#endif
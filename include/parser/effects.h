@@ -0,0 +1,453 @@
+#ifndef RAW_EFFECTS_HPP
+#define RAW_EFFECTS_HPP
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <parser/directives.h>
+#include <parser/gradient.h>
+#include <utils/thread_pool.h>
+
+namespace raw
+{
+/**
+ * Tags of the text effects mod (<wave a=1.0>text</wave>...)
+ * The converter leaves them as plain text, this only parses and checks them
+ */
+namespace effects
+{
+    enum class Type : uint8_t { FLOAT, INT, BOOL, COLOR };
+
+    struct Param
+    {
+        std::string_view name;
+        Type type;
+        double min;
+        double max;
+    };
+
+    struct Effect
+    {
+        std::string_view name;
+        std::span<const Param> params;
+    };
+
+    namespace detail
+    {
+        inline constexpr Param WAVE_LIKE[] = {
+            {"a", Type::FLOAT, 0.0, 100.0}, {"f", Type::FLOAT, 0.0, 100.0}, {"w", Type::FLOAT, -100.0, 100.0}
+        };
+        inline constexpr Param FADE[] = {
+            {"a", Type::FLOAT, 0.0, 1.0}, {"f", Type::FLOAT, 0.0, 100.0}, {"w", Type::FLOAT, -100.0, 100.0}
+        };
+        inline constexpr Param GLITCH[] = {
+            {"f", Type::FLOAT, 0.0, 100.0}, {"j", Type::FLOAT, 0.0, 1.0}, {"b", Type::FLOAT, 0.0, 1.0}, {"s", Type::FLOAT, 0.0, 1.0}
+        };
+        inline constexpr Param GRAD[] = {
+            {"from", Type::COLOR, 0, 0}, {"to", Type::COLOR, 0, 0}, {"hue", Type::BOOL, 0, 0},
+            {"f", Type::FLOAT, 0.0, 100.0}, {"sp", Type::FLOAT, -1000.0, 1000.0}, {"uni", Type::BOOL, 0, 0}
+        };
+        inline constexpr Param NEON[] = {
+            {"p", Type::INT, 1, 64}, {"r", Type::FLOAT, 0.0, 16.0}, {"a", Type::FLOAT, 0.0, 1.0}
+        };
+        inline constexpr Param PEND[] = {
+            {"f", Type::FLOAT, 0.0, 100.0}, {"a", Type::FLOAT, -360.0, 360.0}, {"r", Type::FLOAT, -360.0, 360.0}
+        };
+        inline constexpr Param PULSE[] = {
+            {"base", Type::FLOAT, 0.0, 1.0}, {"a", Type::FLOAT, 0.0, 1.0}, {"f", Type::FLOAT, 0.0, 100.0}, {"w", Type::FLOAT, -100.0, 100.0}
+        };
+        inline constexpr Param RAINB[] = {
+            {"f", Type::FLOAT, 0.0, 100.0}, {"w", Type::FLOAT, -100.0, 100.0}
+        };
+        inline constexpr Param SHADOW[] = {
+            {"x", Type::FLOAT, -16.0, 16.0}, {"y", Type::FLOAT, -16.0, 16.0}, {"c", Type::COLOR, 0, 0}, {"a", Type::FLOAT, 0.0, 1.0}
+        };
+        inline constexpr Param SHAKE[] = {
+            {"a", Type::FLOAT, 0.0, 100.0}, {"f", Type::FLOAT, 0.0, 100.0}
+        };
+    }
+
+    //Same effects as the Mod Effects buttons, parameters are optional (the mod has defaults)
+    inline constexpr std::array EFFECTS = {
+        Effect{"typewriter", {}},
+        Effect{"bounce", detail::WAVE_LIKE},
+        Effect{"fade", detail::FADE},
+        Effect{"glitch", detail::GLITCH},
+        Effect{"grad", detail::GRAD},
+        Effect{"neon", detail::NEON},
+        Effect{"pend", detail::PEND},
+        Effect{"pulse", detail::PULSE},
+        Effect{"rainb", detail::RAINB},
+        Effect{"shadow", detail::SHADOW},
+        Effect{"shake", detail::SHAKE},
+        Effect{"swing", detail::WAVE_LIKE},
+        Effect{"turb", detail::SHAKE},
+        Effect{"wave", detail::WAVE_LIKE},
+        Effect{"wiggle", detail::WAVE_LIKE},
+    };
+
+    constexpr const Effect* find_effect(std::string_view name)
+    {
+        for(const auto& effect : EFFECTS)
+        {
+            if(effect.name == name) return &effect;
+        }
+        return nullptr;
+    }
+
+    struct Argument
+    {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    /**
+     * @brief One <tag>...</tag>, positions are byte offsets in the text
+     * Children are the nodes with parent == this index, in order
+     */
+    struct Node
+    {
+        const Effect* effect = nullptr; //nullptr for tags that aren't effects
+        std::string_view name;
+        std::vector<Argument> arguments;
+        size_t open_begin = 0;   //'<' of the opening tag
+        size_t open_end = 0;     //after its '>'
+        size_t close_begin = 0;  //'<' of the closing tag, npos if it's never closed
+        size_t close_end = 0;
+        int32_t parent = -1;
+    };
+
+    enum class Severity : uint8_t { WARNING, ERROR };
+
+    struct Issue
+    {
+        Severity severity;
+        size_t position; //byte offset
+        size_t line;     //1 based
+        size_t column;   //1 based, in bytes
+        std::string message;
+    };
+
+    struct Document
+    {
+        std::vector<Node> nodes; //in the order their tags open
+        std::vector<Issue> issues;
+
+        bool hasErrors() const
+        {
+            for(const auto& issue : issues)
+            {
+                if(issue.severity == Severity::ERROR) return true;
+            }
+            return false;
+        }
+    };
+
+    namespace detail
+    {
+        constexpr bool nameChar(char c)
+        {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        }
+
+        constexpr bool space(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        inline std::string number_text(double value)
+        {
+            char buffer[32];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            return std::string(buffer, result.ptr);
+        }
+
+        //Joins the parts of a message with append, chained + on temporaries trips -Wrestrict at -O3
+        inline std::string concat(std::initializer_list<std::string_view> parts)
+        {
+            size_t size = 0;
+            for(std::string_view part : parts) size += part.size();
+            std::string out;
+            out.reserve(size);
+            for(std::string_view part : parts) out.append(part);
+            return out;
+        }
+
+        class Builder
+        {
+        private:
+            std::string_view text_;
+            Document& doc_;
+            size_t line_ = 1;
+            size_t line_start_ = 0;
+            size_t counted_ = 0; //newlines are counted up to here
+
+        public:
+            Builder(std::string_view text, Document& doc) : text_(text), doc_(doc) {}
+
+            //Issues come in position order most of the time, so lines are counted only once
+            void report(Severity severity, size_t position, std::string message)
+            {
+                if(position < counted_)
+                {
+                    line_ = 1;
+                    line_start_ = 0;
+                    counted_ = 0;
+                }
+                for(; counted_ < position; counted_++)
+                {
+                    if(text_[counted_] == '\n')
+                    {
+                        line_++;
+                        line_start_ = counted_ + 1;
+                    }
+                }
+                doc_.issues.push_back({severity, position, line_, position - line_start_ + 1, std::move(message)});
+            }
+
+            void checkValue(const Node& node, const Param& param, std::string_view value, size_t position)
+            {
+                const std::string where = concat({"'", param.name, "' of <", node.name, ">"});
+                switch(param.type)
+                {
+                    case Type::BOOL:
+                        if(value != "true" && value != "false")
+                        {
+                            report(Severity::ERROR, position, concat({where, " must be true or false"}));
+                        }
+                        return;
+                    case Type::COLOR: {
+                        gradient::rgb color;
+                        if(!value.empty() && value[0] == '#') value.remove_prefix(1);
+                        if(value.size() != 6 || !gradient::parse_rgb(value, color))
+                        {
+                            report(Severity::ERROR, position, concat({where, " must be a color like #RRGGBB"}));
+                        }
+                        return;
+                    }
+                    case Type::INT:
+                    case Type::FLOAT: {
+                        double number = 0;
+                        const char* end = value.data() + value.size();
+                        auto parsed = std::from_chars(value.data(), end, number);
+                        if(parsed.ec != std::errc() || parsed.ptr != end)
+                        {
+                            report(Severity::ERROR, position, concat({where, " must be a number"}));
+                            return;
+                        }
+                        if(param.type == Type::INT && number != static_cast<double>(static_cast<long long>(number)))
+                        {
+                            report(Severity::ERROR, position, concat({where, " must be a whole number"}));
+                            return;
+                        }
+                        if(number < param.min || number > param.max)
+                        {
+                            report(Severity::WARNING, position, concat({where, " is ", value, ", expected ",
+                                   number_text(param.min), " to ", number_text(param.max)}));
+                        }
+                        return;
+                    }
+                }
+            }
+
+            /**
+             * @brief Reads the tag at text[pos] ('<')
+             * @return Position after it, or pos if it isn't a tag (a lone '<' is text)
+             */
+            size_t readTag(size_t pos, std::vector<int32_t>& open)
+            {
+                const bool closing = pos + 1 < text_.size() && text_[pos + 1] == '/';
+                size_t name_begin = pos + (closing ? 2 : 1);
+                size_t name_end = name_begin;
+                while(name_end < text_.size() && nameChar(text_[name_end])) name_end++;
+
+                //"a < b", "<3" and such are just text
+                if(name_end == name_begin || text_[name_begin] < 'a' || text_[name_begin] > 'z') return pos;
+                const std::string_view name = text_.substr(name_begin, name_end - name_begin);
+
+                const size_t close = text_.find('>', name_end);
+                const size_t next_open = text_.find('<', name_end);
+                if(close == std::string_view::npos || next_open < close)
+                {
+                    if(find_effect(name)) report(Severity::ERROR, pos, concat({"<", name, " is missing its '>'"}));
+                    return pos;
+                }
+
+                if(closing)
+                {
+                    closeTag(name, pos, close + 1, open);
+                    return close + 1;
+                }
+
+                Node node;
+                node.effect = find_effect(name);
+                node.name = name;
+                node.open_begin = pos;
+                node.open_end = close + 1;
+                node.close_begin = std::string_view::npos;
+                node.parent = open.empty() ? -1 : open.back();
+
+                if(!node.effect)
+                {
+                    report(Severity::WARNING, pos, concat({"Unknown effect <", name, ">"}));
+                }
+
+                //key=value pairs
+                size_t at = name_end;
+                while(at < close)
+                {
+                    while(at < close && space(text_[at])) at++;
+                    if(at >= close) break;
+                    if(text_[at] == '/' && at + 1 == close)
+                    {
+                        report(Severity::ERROR, at, concat({"<", name, "/> can't close itself, use </", name, ">"}));
+                        break;
+                    }
+
+                    const size_t key_begin = at;
+                    while(at < close && nameChar(text_[at])) at++;
+                    const std::string_view key = text_.substr(key_begin, at - key_begin);
+                    if(key.empty() || at >= close || text_[at] != '=')
+                    {
+                        report(Severity::ERROR, key_begin, concat({"Expected name=value in <", name, ">"}));
+                        while(at < close && !space(text_[at])) at++;
+                        continue;
+                    }
+                    at++;
+                    const size_t value_begin = at;
+                    while(at < close && !space(text_[at])) at++;
+                    const std::string_view value = text_.substr(value_begin, at - value_begin);
+
+                    bool repeated = false;
+                    for(const auto& previous : node.arguments) repeated |= previous.name == key;
+                    if(repeated)
+                    {
+                        report(Severity::ERROR, key_begin, concat({"'", key, "' is set twice in <", name, ">"}));
+                    }
+                    node.arguments.push_back({key, value});
+
+                    if(!node.effect) continue;
+                    const Param* param = nullptr;
+                    for(const auto& p : node.effect->params)
+                    {
+                        if(p.name == key) param = &p;
+                    }
+                    if(!param)
+                    {
+                        report(Severity::ERROR, key_begin, concat({"<", name, "> has no parameter '", key, "'"}));
+                        continue;
+                    }
+                    checkValue(node, *param, value, value_begin);
+                }
+
+                open.push_back(static_cast<int32_t>(doc_.nodes.size()));
+                doc_.nodes.push_back(std::move(node));
+                return close + 1;
+            }
+
+            void closeTag(std::string_view name, size_t begin, size_t end, std::vector<int32_t>& open)
+            {
+                //the nearest open tag with that name, the ones above it were never closed
+                size_t depth = open.size();
+                while(depth > 0 && doc_.nodes[open[depth - 1]].name != name) depth--;
+                if(depth == 0)
+                {
+                    report(Severity::ERROR, begin, concat({"</", name, "> closes nothing"}));
+                    return;
+                }
+                while(open.size() > depth)
+                {
+                    const Node& unclosed = doc_.nodes[open.back()];
+                    report(Severity::ERROR, begin, concat({"<", unclosed.name, "> (at ", std::to_string(unclosed.open_begin),
+                           ") has to be closed before </", name, ">"}));
+                    open.pop_back();
+                }
+                Node& node = doc_.nodes[open.back()];
+                node.close_begin = begin;
+                node.close_end = end;
+                open.pop_back();
+            }
+        };
+    }
+
+    /**
+     * @brief Parses every effect tag of a text and checks it
+     * & commands are skipped whole, so a '<' inside &@url:"..." or a hover isn't a tag
+     */
+    inline Document parse(std::string_view text)
+    {
+        Document doc;
+        detail::Builder builder(text, doc);
+        std::vector<int32_t> open;
+
+        size_t pos = 0;
+        while(pos < text.size())
+        {
+            const char c = text[pos];
+            if(c == '&')
+            {
+                const directives::Match command = directives::match(text, pos);
+                pos += command.directive ? command.length : 1;
+                continue;
+            }
+            if(c == '<')
+            {
+                const size_t next = builder.readTag(pos, open);
+                pos = next == pos ? pos + 1 : next;
+                continue;
+            }
+            pos++;
+        }
+
+        for(int32_t index : open)
+        {
+            const Node& node = doc.nodes[index];
+            builder.report(Severity::ERROR, node.open_begin, detail::concat({"<", node.name, "> is never closed"}));
+        }
+        return doc;
+    }
+
+    struct Result
+    {
+        size_t index; //position of the text in the input
+        std::vector<Issue> issues;
+    };
+
+    /**
+     * @brief Checks every text on the pool
+     * Only texts with issues are returned, sorted by index
+     */
+    inline std::vector<Result> validate(std::span<const std::string> texts,
+                                        utils::thread_pool& pool = utils::thread_pool::shared())
+    {
+        constexpr size_t CHUNK_SIZE = 256;
+        std::vector<std::vector<Result>> chunks((texts.size() + CHUNK_SIZE - 1) / CHUNK_SIZE);
+
+        pool.parallel_for(texts.size(), CHUNK_SIZE, [&](size_t begin, size_t end) {
+            auto& found = chunks[begin / CHUNK_SIZE];
+            for(size_t i = begin; i < end; i++)
+            {
+                //most texts have no tags at all
+                if(texts[i].find('<') == std::string::npos) continue;
+                Document doc = parse(texts[i]);
+                if(!doc.issues.empty()) found.push_back({i, std::move(doc.issues)});
+            }
+        });
+
+        std::vector<Result> results;
+        for(auto& chunk : chunks)
+        {
+            for(auto& result : chunk) results.push_back(std::move(result));
+        }
+        return results;
+    }
+}
+}
+
+#endif
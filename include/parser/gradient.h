@@ -0,0 +1,456 @@
+#ifndef RAW_GRADIENT_HPP
+#define RAW_GRADIENT_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utils/escape.h>
+#include <utils/utf8.h>
+
+namespace raw
+{
+namespace gradient
+{
+    /**
+     * @brief Color space used to blend between two stops
+     * SRGB is the classic behaviour (straight lerp of the hex values)
+     * OKLAB keeps the perceived lightness even, no muddy middle colors
+     * HSV walks the hue wheel through the shortest arc
+     */
+    enum class Mode {SRGB, OKLAB, HSV};
+
+    //0xRRGGBB
+    using rgb = uint32_t;
+
+    //Positions along the gradient are 32.32 fixed point, integer part = stop index
+    constexpr int FRACTION_BITS = 32;
+
+    //How many characters are colored at once, keeps the color buffer on the stack
+    constexpr size_t BLOCK_SIZE = 64;
+
+    struct HexTable
+    {
+        char pairs[512];
+
+        constexpr HexTable() : pairs()
+        {
+            constexpr char digits[] = "0123456789ABCDEF";
+            for(int i = 0; i < 256; i++)
+            {
+                pairs[i * 2] = digits[i >> 4];
+                pairs[i * 2 + 1] = digits[i & 0xF];
+            }
+        }
+    };
+
+    inline constexpr HexTable HEX_TABLE{};
+
+    /**
+     * @brief Parse "RRGGBB" or "#RRGGBB" into a packed color
+     *
+     * @return false if it isn't 6 hex digits, out is left untouched
+     */
+    inline constexpr bool parse_rgb(std::string_view hex, rgb& out)
+    {
+        if(!hex.empty() && hex[0] == '#') hex.remove_prefix(1);
+        if(hex.size() != 6) return false;
+
+        rgb value = 0;
+        for(char c : hex)
+        {
+            int digit = utils::hex_digit(c);
+            if(digit < 0) return false;
+            value = (value << 4) | static_cast<rgb>(digit);
+        }
+        out = value;
+        return true;
+    }
+
+    //Writes the 6 hex digits of color, no '#', no null terminator
+    inline void write_hex(char* dst, rgb color)
+    {
+        const char* r = &HEX_TABLE.pairs[((color >> 16) & 0xFF) * 2];
+        const char* g = &HEX_TABLE.pairs[((color >> 8) & 0xFF) * 2];
+        const char* b = &HEX_TABLE.pairs[(color & 0xFF) * 2];
+        dst[0] = r[0]; dst[1] = r[1];
+        dst[2] = g[0]; dst[3] = g[1];
+        dst[4] = b[0]; dst[5] = b[1];
+    }
+
+    namespace detail
+    {
+        struct Lab
+        {
+            float l;
+            float a;
+            float b;
+        };
+
+        struct Hsv
+        {
+            float h; //0 to 1
+            float s;
+            float v;
+        };
+
+        inline uint8_t to_byte(float v)
+        {
+            return static_cast<uint8_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+
+        inline const float* srgb_to_linear_table()
+        {
+            static const auto table = []() {
+                struct { float values[256]; } t;
+                for(int i = 0; i < 256; i++)
+                {
+                    float c = i / 255.0f;
+                    t.values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                }
+                return t;
+            }();
+            return table.values;
+        }
+
+        inline float linear_to_srgb(float c)
+        {
+            return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+        }
+
+        //https://bottosson.github.io/posts/oklab/
+        inline Lab to_oklab(rgb color)
+        {
+            const float* lin = srgb_to_linear_table();
+            float r = lin[(color >> 16) & 0xFF];
+            float g = lin[(color >> 8) & 0xFF];
+            float b = lin[color & 0xFF];
+
+            float l = std::cbrt(0.4122214708f * r + 0.5363325363f * g + 0.0514459929f * b);
+            float m = std::cbrt(0.2119034982f * r + 0.6806995451f * g + 0.1073969566f * b);
+            float s = std::cbrt(0.0883024619f * r + 0.2817188376f * g + 0.6299787005f * b);
+
+            return {
+                0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+                1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+                0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s
+            };
+        }
+
+        inline rgb from_oklab(Lab lab)
+        {
+            float l = lab.l + 0.3963377774f * lab.a + 0.2158037573f * lab.b;
+            float m = lab.l - 0.1055613458f * lab.a - 0.0638541728f * lab.b;
+            float s = lab.l - 0.0894841775f * lab.a - 1.2914855480f * lab.b;
+            l = l * l * l;
+            m = m * m * m;
+            s = s * s * s;
+
+            float r = 4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s;
+            float g = -1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s;
+            float b = -0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s;
+
+            return (static_cast<rgb>(to_byte(linear_to_srgb(r))) << 16) |
+                   (static_cast<rgb>(to_byte(linear_to_srgb(g))) << 8) |
+                    static_cast<rgb>(to_byte(linear_to_srgb(b)));
+        }
+
+        inline Hsv to_hsv(rgb color)
+        {
+            float r = ((color >> 16) & 0xFF) / 255.0f;
+            float g = ((color >> 8) & 0xFF) / 255.0f;
+            float b = (color & 0xFF) / 255.0f;
+
+            float max = std::max({r, g, b});
+            float min = std::min({r, g, b});
+            float delta = max - min;
+
+            Hsv out{0.0f, max == 0.0f ? 0.0f : delta / max, max};
+            if(delta == 0.0f) return out;
+
+            if(max == r) out.h = (g - b) / delta;
+            else if(max == g) out.h = 2.0f + (b - r) / delta;
+            else out.h = 4.0f + (r - g) / delta;
+
+            out.h /= 6.0f;
+            if(out.h < 0.0f) out.h += 1.0f;
+            return out;
+        }
+
+        inline rgb from_hsv(Hsv hsv)
+        {
+            float h = (hsv.h - std::floor(hsv.h)) * 6.0f;
+            int sector = static_cast<int>(h) % 6;
+            float f = h - std::floor(h);
+            float p = hsv.v * (1.0f - hsv.s);
+            float q = hsv.v * (1.0f - hsv.s * f);
+            float t = hsv.v * (1.0f - hsv.s * (1.0f - f));
+
+            float r, g, b;
+            switch(sector)
+            {
+                case 0: r = hsv.v; g = t; b = p; break;
+                case 1: r = q; g = hsv.v; b = p; break;
+                case 2: r = p; g = hsv.v; b = t; break;
+                case 3: r = p; g = q; b = hsv.v; break;
+                case 4: r = t; g = p; b = hsv.v; break;
+                default: r = hsv.v; g = p; b = q; break;
+            }
+            return (static_cast<rgb>(to_byte(r)) << 16) |
+                   (static_cast<rgb>(to_byte(g)) << 8) |
+                    static_cast<rgb>(to_byte(b));
+        }
+
+        /**
+         * @brief Blend from -> to for count characters, all inside the same pair of stops
+         * pos is the fraction of the first character (0.32 fixed point), step the increment per character
+         * Plain integer math on constant stops, so the compiler can vectorize it
+         */
+        inline void lerp_srgb(rgb from, rgb to, uint64_t pos, uint64_t step, size_t count, rgb* out)
+        {
+            const uint32_t r1 = (from >> 16) & 0xFF, r2 = (to >> 16) & 0xFF;
+            const uint32_t g1 = (from >> 8) & 0xFF, g2 = (to >> 8) & 0xFF;
+            const uint32_t b1 = from & 0xFF, b2 = to & 0xFF;
+
+            for(size_t j = 0; j < count; j++)
+            {
+                const uint32_t f = static_cast<uint32_t>((pos + j * step) >> 16) & 0xFFFF;
+                const uint32_t inv = 0x10000 - f;
+                const uint32_t r = (r1 * inv + r2 * f + 0x8000) >> 16;
+                const uint32_t g = (g1 * inv + g2 * f + 0x8000) >> 16;
+                const uint32_t b = (b1 * inv + b2 * f + 0x8000) >> 16;
+                out[j] = (r << 16) | (g << 8) | b;
+            }
+        }
+
+        inline void lerp_oklab(rgb from, rgb to, uint64_t pos, uint64_t step, size_t count, rgb* out)
+        {
+            const Lab a = to_oklab(from);
+            const Lab b = to_oklab(to);
+            for(size_t j = 0; j < count; j++)
+            {
+                const float t = static_cast<float>((pos + j * step) >> 16 & 0xFFFF) / 65536.0f;
+                out[j] = from_oklab({
+                    a.l + (b.l - a.l) * t,
+                    a.a + (b.a - a.a) * t,
+                    a.b + (b.b - a.b) * t
+                });
+            }
+        }
+
+        inline void lerp_hsv(rgb from, rgb to, uint64_t pos, uint64_t step, size_t count, rgb* out)
+        {
+            Hsv a = to_hsv(from);
+            Hsv b = to_hsv(to);
+            //grays have no hue, borrow the other one so we don't drift through red
+            if(a.s == 0.0f) a.h = b.h;
+            if(b.s == 0.0f) b.h = a.h;
+
+            float dh = b.h - a.h;
+            if(dh > 0.5f) dh -= 1.0f;
+            else if(dh < -0.5f) dh += 1.0f;
+
+            for(size_t j = 0; j < count; j++)
+            {
+                const float t = static_cast<float>((pos + j * step) >> 16 & 0xFFFF) / 65536.0f;
+                out[j] = from_hsv({
+                    a.h + dh * t,
+                    a.s + (b.s - a.s) * t,
+                    a.v + (b.v - a.v) * t
+                });
+            }
+        }
+    } // namespace detail
+
+    /**
+     * @brief Color of characters [first, first + count) of a gradient of total characters
+     * Characters are spread evenly, the first gets stops[0] and the last one the last stop
+     *
+     * @param stops Parsed colors, at least one
+     * @param out Needs room for count colors
+     */
+    inline void sample(const rgb* stops, size_t stop_count, size_t total, size_t first, size_t count, Mode mode, rgb* out)
+    {
+        if(stop_count == 0 || count == 0) return;
+        if(stop_count == 1 || total < 2)
+        {
+            std::fill(out, out + count, stops[0]);
+            return;
+        }
+
+        const uint64_t last_stop = static_cast<uint64_t>(stop_count - 1);
+        const uint64_t span = last_stop << FRACTION_BITS;
+        //rounded up so exact stop positions never land on the previous pair
+        const uint64_t step = (span + (total - 2)) / (total - 1);
+
+        size_t j = first;
+        const size_t end = first + count;
+        while(j < end)
+        {
+            const uint64_t pos = static_cast<uint64_t>(j) * step;
+            const uint64_t index = pos >> FRACTION_BITS;
+            if(index >= last_stop)
+            {
+                std::fill(out + (j - first), out + count, stops[last_stop]);
+                break;
+            }
+
+            //first character that belongs to the next pair of stops
+            const uint64_t next = (index + 1) << FRACTION_BITS;
+            const size_t run_end = std::min<size_t>(end, static_cast<size_t>((next + step - 1) / step));
+            const uint64_t fraction = pos - (index << FRACTION_BITS);
+            rgb* dst = out + (j - first);
+
+            switch(mode)
+            {
+                case Mode::OKLAB:
+                    detail::lerp_oklab(stops[index], stops[index + 1], fraction, step, run_end - j, dst);
+                    break;
+                case Mode::HSV:
+                    detail::lerp_hsv(stops[index], stops[index + 1], fraction, step, run_end - j, dst);
+                    break;
+                default:
+                    detail::lerp_srgb(stops[index], stops[index + 1], fraction, step, run_end - j, dst);
+                    break;
+            }
+            j = run_end;
+        }
+    }
+
+    namespace detail
+    {
+        /**
+         * @brief Writes "&#RRGGBB" codes and characters, skipping codes for characters that look the same
+         * With a threshold, a run goes on while every color is within delta_e (OKLab distance * 100)
+         * of the first one, and the run gets the color halfway between its first and last character
+         */
+        class RunWriter
+        {
+        private:
+            char* dst_;
+            float limit_; //squared, in OKLab units
+            char* code_ = nullptr; //hex digits of the current run
+            rgb first_ = 0;
+            rgb last_ = 0;
+            Lab first_lab_{};
+
+            void closeRun()
+            {
+                if(!code_ || first_ == last_) return;
+                rgb mid = 0;
+                for(int shift = 0; shift <= 16; shift += 8)
+                {
+                    const rgb a = (first_ >> shift) & 0xFF;
+                    const rgb b = (last_ >> shift) & 0xFF;
+                    mid |= ((a + b + 1) / 2) << shift;
+                }
+                write_hex(code_, mid);
+            }
+
+        public:
+            RunWriter(char* dst, float delta_e) : dst_(dst), limit_(delta_e / 100.0f * (delta_e / 100.0f)) {}
+
+            void put(rgb color, const char* character, size_t length)
+            {
+                bool same = false;
+                if(limit_ > 0.0f && code_)
+                {
+                    if(color == first_) same = true;
+                    else
+                    {
+                        const Lab lab = to_oklab(color);
+                        const float dl = lab.l - first_lab_.l;
+                        const float da = lab.a - first_lab_.a;
+                        const float db = lab.b - first_lab_.b;
+                        same = dl * dl + da * da + db * db <= limit_;
+                    }
+                }
+
+                if(same)
+                {
+                    last_ = color;
+                }
+                else
+                {
+                    closeRun();
+                    dst_[0] = '&';
+                    dst_[1] = '#';
+                    write_hex(dst_ + 2, color);
+                    code_ = dst_ + 2;
+                    first_ = last_ = color;
+                    if(limit_ > 0.0f) first_lab_ = to_oklab(color);
+                    dst_ += 8;
+                }
+                std::memcpy(dst_, character, length);
+                dst_ += length;
+            }
+
+            char* finish()
+            {
+                closeRun();
+                return dst_;
+            }
+        };
+    }
+
+    /**
+     * @brief Appends "&#RRGGBB<c>" for every visible character of text
+     * A character is a grapheme cluster, so accents, emoji and such keep all their bytes under one color
+     * The output is sized once and the colors are written block by block, no allocation per character
+     * @param delta_e Characters this close in color share one code (OKLab distance * 100), 0 = one code each
+     */
+    inline void apply(std::string& out, std::string_view text, const rgb* stops, size_t stop_count, Mode mode,
+                      float delta_e = 0.0f)
+    {
+        if(text.empty() || stop_count == 0) return;
+
+        const size_t at = out.size();
+        rgb colors[BLOCK_SIZE];
+
+        //one byte, one character
+        if(delta_e <= 0.0f && utils::utf8::is_ascii(text))
+        {
+            out.resize(at + text.size() * 9);
+            char* dst = out.data() + at;
+            for(size_t first = 0; first < text.size(); first += BLOCK_SIZE)
+            {
+                const size_t count = std::min(BLOCK_SIZE, text.size() - first);
+                sample(stops, stop_count, text.size(), first, count, mode, colors);
+                for(size_t j = 0; j < count; j++)
+                {
+                    dst[0] = '&';
+                    dst[1] = '#';
+                    write_hex(dst + 2, colors[j]);
+                    dst[8] = text[first + j];
+                    dst += 9;
+                }
+            }
+            return;
+        }
+
+        const bool ascii = utils::utf8::is_ascii(text);
+        const size_t total = ascii ? text.size() : utils::utf8::count_clusters(text);
+        out.resize(at + total * 8 + text.size());
+        detail::RunWriter writer(out.data() + at, delta_e);
+        size_t pos = 0;
+        for(size_t first = 0; first < total; first += BLOCK_SIZE)
+        {
+            const size_t count = std::min(BLOCK_SIZE, total - first);
+            sample(stops, stop_count, total, first, count, mode, colors);
+            for(size_t j = 0; j < count; j++)
+            {
+                const size_t end = ascii ? pos + 1 : utils::utf8::next_cluster(text, pos);
+                writer.put(colors[j], text.data() + pos, end - pos);
+                pos = end;
+            }
+        }
+        out.resize(static_cast<size_t>(writer.finish() - out.data()));
+    }
+
+} // namespace gradient
+} // namespace raw
+
+#endif
@@ -0,0 +1,327 @@
+#ifndef RAW_INCREMENTAL_HPP
+#define RAW_INCREMENTAL_HPP
+
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <parser/raw.h>
+#include <utils/hash.h>
+
+namespace raw
+{
+    /**
+     * @brief to_json for the live preview
+     * The text is cut before every &r and &@page and each piece is converted on its own,
+     * cached by the hash of its text (and the style it starts with, &r pieces don't care)
+     * Editing a long book only converts again the piece being edited, the rest is just glued
+     */
+    class IncrementalConverter
+    {
+    private:
+        struct Segment
+        {
+            std::string source;
+            std::string expanded; //after change_gradient, the IR points inside it
+            detail::Components ir;
+            detail::State state_out;
+            std::string written; //components of the piece, comma separated
+            size_t first_end = 0; //size of the first component inside written
+            bool needs_empty_parent = false; //the first component has style, see write_components
+            bool non_ftb = false;
+            uint64_t generation = 0;
+        };
+
+        std::unordered_map<uint64_t, std::unique_ptr<Segment>> cache;
+        std::string last_text;
+        Options last_options;
+        bool has_output = false;
+        std::string result;
+        Report report;
+        uint64_t generation = 0;
+        size_t reused = 0;
+        size_t converted = 0;
+
+        static uint64_t hashState(const detail::State& s)
+        {
+            uint64_t flags = (s.bold ? 1 : 0) | (s.italic ? 2 : 0) | (s.underlined ? 4 : 0) |
+                             (s.strikethrough ? 8 : 0) | (s.obfuscated ? 16 : 0);
+            uint64_t h = utils::combine(utils::hash64(s.color), flags);
+            h = utils::combine(h, utils::hash64(s.click_action));
+            h = utils::combine(h, utils::hash64(s.click_value));
+            h = utils::combine(h, utils::hash64(s.hover_action));
+            h = utils::combine(h, utils::hash64(s.hover_value));
+            return utils::combine(h, utils::hash64(s.shadow));
+        }
+
+        static void writeSegment(Segment& segment)
+        {
+            for(const auto& c : segment.ir.list)
+            {
+                if(!segment.written.empty()) segment.written += ',';
+                if(c.page_break) segment.written += "{\"text\":\"\\n{@pagebreak}\\n\"}";
+                else detail::write_component(segment.written, segment.ir.textOf(c), c.state);
+
+                if(segment.first_end == 0)
+                {
+                    segment.first_end = segment.written.size();
+                    segment.needs_empty_parent = !c.page_break && detail::has_extra_properties(c.state);
+                }
+            }
+        }
+
+        //Same layout as detail::write_components, built from the already written pieces
+        void glue(const std::vector<Segment*>& segments, bool use_extra)
+        {
+            size_t components = 0;
+            size_t size = 0;
+            bool has_formatting = false;
+            size_t first_index = segments.size();
+            for(size_t i = 0; i < segments.size(); i++)
+            {
+                const Segment* segment = segments[i];
+                components += segment->ir.list.size();
+                size += segment->written.size() + 1;
+                has_formatting = has_formatting || segment->ir.has_formatting;
+                if(first_index == segments.size() && !segment->written.empty()) first_index = i;
+            }
+
+            result.clear();
+            if(!has_formatting)
+            {
+                std::string text;
+                for(const Segment* segment : segments) text += segment->ir.text;
+                result = "\"" + json_escape(text) + "\"";
+            }
+            else if(components == 0)
+            {
+                result = "\"\"";
+            }
+            if(!result.empty())
+            {
+                report = {result.size(), result.size(), 0, 0};
+                return;
+            }
+
+            const Segment* first = segments[first_index];
+            const bool empty_parent = first->needs_empty_parent;
+            if(empty_parent) components++;
+            result.reserve(size + 32);
+
+            auto append_rest = [&](size_t skip) {
+                bool comma = false;
+                for(size_t i = first_index; i < segments.size(); i++)
+                {
+                    const Segment* segment = segments[i];
+                    if(segment->written.empty()) continue;
+                    if(i == first_index)
+                    {
+                        if(skip >= segment->written.size()) continue;
+                        if(comma) result += ',';
+                        result.append(segment->written, skip);
+                    }
+                    else
+                    {
+                        if(comma) result += ',';
+                        result += segment->written;
+                    }
+                    comma = true;
+                }
+            };
+
+            if(!use_extra)
+            {
+                result += empty_parent ? "[{\"text\":\"\"}," : "[";
+                append_rest(0);
+                result += ']';
+            }
+            else if(empty_parent)
+            {
+                result += "{\"text\":\"\",\"extra\":[";
+                append_rest(0);
+                result += "]}";
+            }
+            else if(components == 1)
+            {
+                result += '[';
+                result += first->written;
+                result += ']';
+            }
+            else
+            {
+                //first component without its brace holds the others
+                result.append(first->written, 0, first->first_end - 1);
+                result += ",\"extra\":[";
+                append_rest(first->first_end + 1);
+                result += "]}";
+            }
+            report = {result.size(), result.size(), components, components};
+        }
+
+    public:
+        /**
+         * @brief Start of every piece, a piece starts at &r or &@page
+         * Quoted arguments (&@url:"...&r..." and friends) are skipped, they are never cut
+         */
+        static std::vector<size_t> split(std::string_view text)
+        {
+            std::vector<size_t> starts{0};
+            size_t i = 0;
+            while(i + 1 < text.size())
+            {
+                const directives::Match command = text[i] == '&' ? directives::match(text, i) : directives::Match();
+                if(!command.directive)
+                {
+                    i++;
+                    continue;
+                }
+
+                const directives::Kind kind = command.directive->kind;
+                if((kind == directives::Kind::RESET || kind == directives::Kind::PAGE) && i != starts.back())
+                {
+                    starts.push_back(i);
+                }
+                i += command.length;
+            }
+            return starts;
+        }
+
+        /**
+         * @brief Converts text if it or the options changed since last call
+         * Cheap to call every frame, with nothing new it's a compare and return
+         *
+         * @return true if output() changed
+         */
+        bool update(const std::string& text, const Options& options)
+        {
+            if(has_output && text == last_text && options == last_options) return false;
+
+            generation++;
+            reused = 0;
+            converted = 0;
+
+            std::vector<Segment*> segments;
+            std::vector<std::unique_ptr<Segment>> uncached; //hash collisions inside this same text
+            const std::vector<size_t> starts = split(text);
+            segments.reserve(starts.size());
+
+            //pieces converted with other gradient settings can't be reused
+            const uint64_t gradient_key = utils::combine(static_cast<uint64_t>(options.gradient),
+                                                         std::bit_cast<uint32_t>(options.delta_e));
+            detail::State state;
+            bool non_ftb = false;
+            for(size_t s = 0; s < starts.size(); s++)
+            {
+                const size_t end = s + 1 < starts.size() ? starts[s + 1] : text.size();
+                std::string_view piece = std::string_view(text).substr(starts[s], end - starts[s]);
+
+                //&r throws away whatever style came before
+                const bool resets = piece.size() >= 2 && piece[1] == 'r' && piece[0] == '&';
+                uint64_t key = utils::hash64(piece, gradient_key);
+                if(!resets) key = utils::combine(key, hashState(state));
+
+                auto* slot = &cache[key];
+                if(*slot && (*slot)->generation == generation && (*slot)->source != piece)
+                {
+                    slot = &uncached.emplace_back();
+                }
+
+                if(*slot && (*slot)->source == piece)
+                {
+                    reused++;
+                }
+                else
+                {
+                    *slot = std::make_unique<Segment>();
+                    Segment& segment = **slot;
+                    segment.source = piece;
+                    segment.expanded = change_gradient(segment.source, options.gradient, options.delta_e);
+                    segment.non_ftb = check_non_ftb(segment.expanded);
+                    segment.state_out = resets ? detail::State() : state;
+                    detail::parse_components(segment.expanded, segment.ir, &segment.state_out);
+                    writeSegment(segment);
+                    converted++;
+                }
+
+                Segment& segment = **slot;
+                segment.generation = generation;
+                state = segment.state_out;
+                non_ftb = non_ftb || segment.non_ftb;
+                segments.push_back(&segment);
+            }
+
+            if(!non_ftb)
+            {
+                result.clear();
+                for(const Segment* segment : segments) result += segment->expanded;
+                report = {result.size(), result.size(), 0, 0};
+            }
+            else if(!options.minimize)
+            {
+                glue(segments, options.use_extra);
+            }
+            else
+            {
+                //the minimizer looks at every component at once
+                detail::Components all;
+                size_t text_size = 0;
+                size_t list_size = 0;
+                for(const Segment* segment : segments)
+                {
+                    text_size += segment->ir.text.size();
+                    list_size += segment->ir.list.size();
+                }
+                all.text.reserve(text_size);
+                all.list.reserve(list_size);
+
+                for(const Segment* segment : segments)
+                {
+                    const size_t base = all.text.size();
+                    all.text += segment->ir.text;
+                    all.has_formatting = all.has_formatting || segment->ir.has_formatting;
+                    for(detail::Component c : segment->ir.list)
+                    {
+                        c.text_begin += base;
+                        c.text_end += base;
+                        all.list.push_back(std::move(c));
+                    }
+                }
+                result = detail::write_output(all, options, &report);
+            }
+
+            //pieces that are gone from the text are not coming back (or will be converted again)
+            std::erase_if(cache, [this](const auto& entry) { return entry.second->generation != generation; });
+
+            last_text = text;
+            last_options = options;
+            has_output = true;
+            return true;
+        }
+
+        const std::string& output() const
+        {
+            return result;
+        }
+
+        const Report& lastReport() const
+        {
+            return report;
+        }
+
+        //Pieces taken from the cache / converted again in the last update
+        size_t reusedSegments() const
+        {
+            return reused;
+        }
+
+        size_t convertedSegments() const
+        {
+            return converted;
+        }
+    };
+}
+
+#endif
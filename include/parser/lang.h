@@ -0,0 +1,195 @@
+#ifndef RAW_LANG_HPP
+#define RAW_LANG_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <parser/batch.h>
+#include <parser/raw.h>
+#include <utils/hash.h>
+#include <utils/thread_pool.h>
+
+namespace raw
+{
+namespace lang
+{
+    enum class Reference : uint8_t
+    {
+        BRACES,    //{key}, what FTB Quests translates in titles and descriptions
+        TRANSLATE  //{"translate":"key"}, plain Minecraft JSON text
+    };
+
+    struct Options
+    {
+        raw::Options convert;
+        std::string prefix = "questimakinator.text";
+        Reference reference = Reference::BRACES;
+    };
+
+    struct Report
+    {
+        size_t texts = 0;
+        size_t unique = 0;           //different texts (short ones that stay inline count as different)
+        size_t inline_bytes = 0;     //every converted text written where it's used
+        size_t reference_bytes = 0;  //the keys written where they're used
+        size_t lang_bytes = 0;       //en_us.json
+
+        size_t duplicates() const { return texts - unique; }
+        size_t packBytes() const { return reference_bytes + lang_bytes; }
+        //what the client parses: before every copy, after every text once
+        long long bytesSaved() const { return static_cast<long long>(inline_bytes) - static_cast<long long>(packBytes()); }
+    };
+
+    /**
+     * @brief Converts texts, gives every different result one key and writes it to the lang file as it goes
+     * Only two hashes per unique text are kept (no strings), so memory doesn't grow with the pack size
+     * Same text, same key: the key comes from the hash, so it survives between runs
+     */
+    class Extractor
+    {
+    private:
+        std::ostream& lang_;
+        Options options_;
+        //first hash -> second hash, together 128 bits to tell texts apart
+        std::unordered_map<uint64_t, uint64_t> seen_;
+        std::unordered_set<uint64_t> long_keys_; //second hash of the texts that collided
+        Report report_;
+        std::string entry_;
+        size_t entries_ = 0;
+        bool finished_ = false;
+
+        static void appendHex(std::string& out, uint64_t value)
+        {
+            static constexpr char digits[] = "0123456789abcdef";
+            for(int shift = 60; shift >= 0; shift -= 4) out += digits[(value >> shift) & 0xF];
+        }
+
+        std::string keyOf(uint64_t first, uint64_t second, bool& is_new)
+        {
+            std::string key = options_.prefix;
+            key += '.';
+            appendHex(key, first);
+
+            auto [it, inserted] = seen_.try_emplace(first, second);
+            is_new = inserted;
+            if(!inserted && it->second != second)
+            {
+                //same first hash, different text: the long key tells them apart
+                key += '_';
+                appendHex(key, second);
+                is_new = long_keys_.insert(second).second;
+            }
+            return key;
+        }
+
+        void writeEntry(std::string_view key, std::string_view text)
+        {
+            entry_.clear();
+            entry_ += entries_ == 0 ? "{\n  \"" : ",\n  \"";
+            json_escape_to(entry_, key);
+            entry_ += "\": \"";
+            json_escape_to(entry_, text);
+            entry_ += '"';
+            lang_ << entry_;
+            report_.lang_bytes += entry_.size();
+            report_.unique++;
+            entries_++;
+        }
+
+    public:
+        Extractor(std::ostream& lang_out, Options options = {})
+            : lang_(lang_out), options_(std::move(options)) {}
+
+        ~Extractor()
+        {
+            finish();
+        }
+
+        //Size of a reference, texts this short stay where they are
+        size_t referenceSize() const
+        {
+            const size_t key = options_.prefix.size() + 1 + 16;
+            return options_.reference == Reference::BRACES ? key + 2 : key + 16;
+        }
+
+        //Already converted text, returns what goes in its place
+        std::string addConverted(std::string_view converted)
+        {
+            if(converted.size() <= referenceSize())
+            {
+                report_.texts++;
+                report_.unique++;
+                report_.inline_bytes += converted.size();
+                report_.reference_bytes += converted.size();
+                return std::string(converted);
+            }
+
+            const uint64_t first = utils::hash64(converted);
+            const uint64_t second = utils::hash64(converted, 0x51ed270b27a1f3c5ULL);
+            bool is_new = false;
+            std::string key = keyOf(first, second, is_new);
+            if(is_new) writeEntry(key, converted);
+
+            std::string reference;
+            if(options_.reference == Reference::BRACES)
+            {
+                reference.reserve(key.size() + 2);
+                reference += '{';
+                reference += key;
+                reference += '}';
+            }
+            else
+            {
+                reference = "{\"translate\":\"";
+                json_escape_to(reference, key);
+                reference += "\"}";
+            }
+
+            report_.texts++;
+            report_.inline_bytes += converted.size();
+            report_.reference_bytes += reference.size();
+            return reference;
+        }
+
+        std::string add(const std::string& markup)
+        {
+            return addConverted(to_json(markup, options_.convert));
+        }
+
+        /**
+         * @brief Converts a batch on the pool, then dedupes it in order
+         * Feed a big pack a batch at a time to keep memory bounded
+         */
+        std::vector<std::string> addBatch(std::span<const std::string> markup,
+                                          utils::thread_pool& pool = utils::thread_pool::shared())
+        {
+            batch::Result converted = batch::convert(markup, options_.convert, pool);
+            std::vector<std::string> references;
+            references.reserve(converted.size());
+            for(size_t i = 0; i < converted.size(); i++) references.push_back(addConverted(converted.at(i)));
+            return references;
+        }
+
+        //Closes the lang file, nothing can be added after it
+        const Report& finish()
+        {
+            if(finished_) return report_;
+            finished_ = true;
+            const char* end = entries_ == 0 ? "{}\n" : "\n}\n";
+            lang_ << end;
+            lang_.flush();
+            report_.lang_bytes += std::char_traits<char>::length(end);
+            return report_;
+        }
+
+        const Report& report() const { return report_; }
+    };
+}
+}
+
+#endif
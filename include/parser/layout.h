@@ -0,0 +1,265 @@
+#ifndef RAW_LAYOUT_HPP
+#define RAW_LAYOUT_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <parser/directives.h>
+#include <parser/raw.h>
+#include <utils/utf8.h>
+
+namespace raw
+{
+/**
+ * How wide text is in Minecraft's default font, in pixels at GUI scale 1, and where it has to wrap
+ * Every glyph has a fixed advance (its width plus the 1px gap), bold adds 1 to each one
+ * Characters outside ASCII come from the fallback fonts and are estimated: 9 for wide (CJK, emoji), 6 for the rest
+ */
+namespace layout
+{
+    //Width of the text in FTB Quests' quest view at its narrowest
+    constexpr int PANEL_WIDTH = 200;
+
+    namespace detail
+    {
+        constexpr std::array<uint8_t, 128> buildAdvances()
+        {
+            std::array<uint8_t, 128> advances{};
+            for(size_t c = 32; c < 127; c++) advances[c] = 6;
+            constexpr std::string_view narrow[] = {
+                "!',.:;i|", //2
+                "`",        //3
+                " \"()*I[]t{}", //4
+                "<>fk",     //5
+            };
+            constexpr uint8_t narrow_advance[] = {2, 3, 4, 5};
+            for(size_t group = 0; group < 4; group++)
+            {
+                for(char c : narrow[group]) advances[static_cast<uint8_t>(c)] = narrow_advance[group];
+            }
+            advances['l'] = 3;
+            advances['@'] = 7;
+            advances['~'] = 7;
+            return advances;
+        }
+
+        inline constexpr std::array<uint8_t, 128> ADVANCES = buildAdvances();
+
+        constexpr bool wide(uint32_t cp)
+        {
+            return (cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF) ||
+                   (cp >= 0xAC00 && cp <= 0xD7A3) || (cp >= 0xF900 && cp <= 0xFAFF) ||
+                   (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF60) ||
+                   (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x1F300 && cp <= 0x1FAFF) ||
+                   (cp >= 0x20000 && cp <= 0x3FFFD);
+        }
+    }
+
+    //Pixels the cursor moves after the character
+    constexpr int advance(uint32_t code_point, bool bold = false)
+    {
+        int width;
+        if(code_point < 128) width = detail::ADVANCES[code_point];
+        else width = detail::wide(code_point) ? 9 : 6;
+        return width && bold ? width + 1 : width;
+    }
+
+    //Advance of the visible character (grapheme cluster) at text[pos, end), marks after the first code point are free
+    inline int cluster_advance(std::string_view text, size_t pos, size_t end, bool bold)
+    {
+        const unsigned char lead = static_cast<unsigned char>(text[pos]);
+        if(lead < 0x80) return advance(lead, bold);
+        return advance(utils::utf8::decode(text.data() + pos, end - pos).code_point, bold);
+    }
+
+    //Width of plain text with one style, the widest line if it has '\n'
+    inline int text_width(std::string_view text, bool bold = false)
+    {
+        int widest = 0;
+        int line = 0;
+        for(size_t pos = 0, end; pos < text.size(); pos = end)
+        {
+            end = utils::utf8::next_cluster(text, pos);
+            if(text[pos] == '\n' || text[pos] == '\r')
+            {
+                line = 0;
+                continue;
+            }
+            line += cluster_advance(text, pos, end, bold);
+            widest = std::max(widest, line);
+        }
+        return widest;
+    }
+
+    struct Metrics
+    {
+        int width = 0;    //widest line
+        size_t lines = 1;
+        size_t pages = 1;
+    };
+
+    //Size of converted components (the IR of to_json), one pass over the text
+    inline Metrics measure(const raw::detail::Components& ir)
+    {
+        Metrics metrics;
+        int line = 0;
+        for(const auto& c : ir.list)
+        {
+            if(c.page_break)
+            {
+                metrics.pages++;
+                metrics.lines++;
+                line = 0;
+                continue;
+            }
+            const std::string_view text = ir.textOf(c);
+            for(size_t pos = 0, end; pos < text.size(); pos = end)
+            {
+                end = utils::utf8::next_cluster(text, pos);
+                if(text[pos] == '\n' || text[pos] == '\r')
+                {
+                    metrics.lines++;
+                    line = 0;
+                    continue;
+                }
+                line += cluster_advance(text, pos, end, c.state.bold);
+                metrics.width = std::max(metrics.width, line);
+            }
+        }
+        return metrics;
+    }
+
+    inline Metrics measure(const std::string& markup, gradient::Mode mode = gradient::Mode::SRGB)
+    {
+        const std::string expanded = change_gradient(markup, mode);
+        raw::detail::Components ir;
+        raw::detail::parse_components(expanded, ir);
+        return measure(ir);
+    }
+
+    struct Options
+    {
+        int width = PANEL_WIDTH;
+        size_t lines_per_page = 0; //0 = no page breaks
+        gradient::Mode gradient = gradient::Mode::SRGB;
+        float delta_e = 0.0f; //same as raw::Options, gradients are expanded here
+    };
+
+    /**
+     * @brief Markup with the line breaks and page breaks it needs to fit options.width
+     * Lines wrap at the last space that fits (the space becomes '\n'), words longer than a line are cut
+     * Every lines_per_page lines the break is an &@page instead (&@page:"" when a word follows it)
+     * Gradients are expanded first so a break doesn't cut them, the result is ready for to_json
+     * One pass, the only text moved again is the end of a line when a space turns into &@page
+     */
+    inline std::string fit(const std::string& markup, const Options& options = {})
+    {
+        const std::string text = change_gradient(markup, options.gradient, options.delta_e);
+        std::string out;
+        out.reserve(text.size() + text.size() / 16);
+
+        bool bold = false;
+        int line = 0;
+        size_t line_count = 0; //lines in the current page
+        size_t space = std::string::npos; //last space of this line inside out
+        int after_space = 0; //width of the line after that space
+        std::vector<size_t> pages; //where every &@page put in ends, earlier ones never move
+
+        auto new_line = [&](size_t at, bool replace) {
+            line_count++;
+            if(options.lines_per_page && line_count >= options.lines_per_page)
+            {
+                //the pagebreak brings its own new lines
+                if(replace) out.replace(at, 1, "&@page");
+                else out.insert(at, "&@page");
+                pages.push_back(at + 6);
+                line_count = 0;
+            }
+            else if(replace) out[at] = '\n';
+            else out.insert(at, 1, '\n');
+            space = std::string::npos;
+        };
+
+        size_t pos = 0;
+        while(pos < text.size())
+        {
+            if(text[pos] == '&')
+            {
+                const directives::Match command = directives::match(text, pos);
+                if(command.directive)
+                {
+                    const directives::Directive& d = *command.directive;
+                    if(d.kind == directives::Kind::RESET) bold = false;
+                    else if(d.kind == directives::Kind::FORMAT && d.index == directives::BOLD) bold = true;
+                    else if(d.kind == directives::Kind::PAGE)
+                    {
+                        line = 0;
+                        line_count = 0;
+                        space = std::string::npos;
+                    }
+                    out.append(text, pos, command.length);
+                    pos += command.length;
+                    continue;
+                }
+            }
+
+            const size_t end = utils::utf8::next_cluster(text, pos);
+            if(text[pos] == '\n' || text[pos] == '\r')
+            {
+                new_line(out.size(), false);
+                pos = end;
+                line = 0;
+                continue;
+            }
+
+            const int width = cluster_advance(text, pos, end, bold);
+            if(line + width > options.width && line > 0)
+            {
+                if(text[pos] == ' ')
+                {
+                    //the space that doesn't fit is the break
+                    new_line(out.size(), false);
+                    line = 0;
+                    pos = end;
+                    continue;
+                }
+                if(space != std::string::npos)
+                {
+                    line = after_space;
+                    new_line(space, true);
+                }
+                else
+                {
+                    line = 0;
+                    new_line(out.size(), false);
+                }
+            }
+
+            if(text[pos] == ' ')
+            {
+                space = out.size();
+                after_space = 0;
+            }
+            else
+            {
+                after_space += width;
+            }
+            line += width;
+            out.append(text, pos, end - pos);
+            pos = end;
+        }
+        //a word right after the break would read as part of its name
+        for(auto it = pages.rbegin(); it != pages.rend(); ++it)
+        {
+            if(directives::needs_close(out, *it)) out.insert(*it, directives::BARE_CLOSE);
+        }
+        return out;
+    }
+}
+}
+
+#endif
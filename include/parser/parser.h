@@ -13,6 +13,7 @@
 #include <vector>
 #include <limits>
 #include <cmath>
+#include <utils/escape.h>
 
 
 namespace snbt
@@ -518,25 +519,7 @@ namespace snbt
             std::string result;
             result.reserve(str.length() + 2);
             result += '"';
-            for (char c : str) {
-                switch (c) {
-                    case '"':  result += "\\\""; break;
-                    case '\\': result += "\\\\"; break;
-                    case '\b': result += "\\b"; break;
-                    case '\f': result += "\\f"; break;
-                    case '\n': result += "\\n"; break;
-                    case '\r': result += "\\r"; break;
-                    case '\t': result += "\\t"; break;
-                    default:
-                        if (static_cast<unsigned char>(c) < 0x20 || c == 0x7F) {
-                            char buf[7];
-                            std::snprintf(buf, sizeof(buf), "\\u%04X", static_cast<unsigned char>(c));
-                            result += buf;
-                        } else {
-                            result += c;
-                        }
-                }
-            }
+            utils::append_escaped(result, str, utils::EscapeStyle::SNBT);
             result += '"';
             return result;
         }
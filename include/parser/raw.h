@@ -1,6 +1,7 @@
 #ifndef RAW_JSON_HPP
 #define RAW_JSON_HPP
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdio>
 #include <iostream>
@@ -8,8 +9,11 @@
 #include <string>
 #include <vector>
 #include <cctype>
-#include <iomanip>
-#include <sstream>
+#include <string_view>
+#include <parser/directives.h>
+#include <parser/gradient.h>
+#include <utils/escape.h>
+
 namespace raw
 {
 
@@ -20,12 +24,6 @@ namespace raw
             "#FF5555", "#FF55FF", "#FFFF55", "#FFFFFF"
     };
 
-    static const std::vector<std::string> IGNORED_COMMANDS = {
-        "l", "o", "n", "m", "0", "1", "2", "3", "4", "5", "6", "7", "8", "9", 
-        "a", "b", "c", "d", "e", "f", "r", "k", "@url:\"", "@in:\"", "@file:\"", 
-        "@command:\"", "@copy:\"", "@change:\"", "@page", "&text:\"", "&item:\"", "&shadow:\""
-    };
-
     inline unsigned int argb_hex_to_decimal(const std::string& argb_hex) {
         if (argb_hex.length() != 8) {
             return 0;
@@ -63,53 +61,34 @@ namespace raw
         return "#ffffff";
     }
 
-    inline bool check_non_ftb(const std::string& text)
+    //True when the text uses something only JSON can show (clicks, hovers, shadows, page breaks)
+    inline bool check_non_ftb(std::string_view text)
     {
-        if(text.contains("&@url:") ||
-           text.contains("&@in:") ||
-           text.contains("&@file:") ||
-           text.contains("&@command:") ||
-           text.contains("&@copy:") ||
-           text.contains("&@change:") ||
-           text.contains("&&text:") ||
-           text.contains("&&item:") ||
-           text.contains("&&shadow:")
-        ) return true;
-
+        for(size_t pos = text.find('&'); pos != std::string_view::npos; pos = text.find('&', pos + 1))
+        {
+            if(pos + 2 >= text.size() || (text[pos + 1] != '@' && text[pos + 1] != '&')) continue;
+            size_t end = pos + 2;
+            while(end < text.size() && directives::detail::nameChar(text[end])) end++;
+            const directives::Directive* d = directives::find_named(text[pos + 1], text.substr(pos + 2, end - pos - 2));
+            if(d && d->non_ftb && (!d->argument || (end < text.size() && text[end] == ':'))) return true;
+        }
         return false;
     }
 
-    inline std::string change_gradient(std::string &text)
+    inline std::string change_gradient(const std::string &text, gradient::Mode mode = gradient::Mode::SRGB, float delta_e = 0.0f)
     {
         struct Text {
-            int start;
-            int end;
-            std::string text;
+            size_t start;
+            size_t end;
+            size_t content_start;
+            size_t limit; //characters to color after content_start
             int type;
-            std::vector<std::string> colors;
-        };
-
-        // Función para interpolar colores
-        auto interpolate_color = [](const std::string& color1, const std::string& color2, float t) -> std::string {
-            int r1 = std::stoi(color1.substr(0, 2), nullptr, 16);
-            int g1 = std::stoi(color1.substr(2, 2), nullptr, 16);
-            int b1 = std::stoi(color1.substr(4, 2), nullptr, 16);
-            
-            int r2 = std::stoi(color2.substr(0, 2), nullptr, 16);
-            int g2 = std::stoi(color2.substr(2, 2), nullptr, 16);
-            int b2 = std::stoi(color2.substr(4, 2), nullptr, 16);
-            
-            int r = static_cast<int>(r1 + (r2 - r1) * t);
-            int g = static_cast<int>(g1 + (g2 - g1) * t);
-            int b = static_cast<int>(b1 + (b2 - b1) * t);
-            
-            char hex_color[7];
-            snprintf(hex_color, sizeof(hex_color), "%02X%02X%02X", r, g, b);
-            return std::string(hex_color);
+            std::vector<gradient::rgb> colors;
         };
 
         // Función para encontrar el límite del texto a modificar
-        auto find_limit = [](const std::string& str) -> size_t {
+        //the gradient stops at the first command after it
+        auto find_limit = [](std::string_view str) -> size_t {
             size_t pos = 0;
             while(pos < str.size())
             {
@@ -118,36 +97,25 @@ namespace raw
                     pos += 2;
                     continue;
                 }
-                
-                if(str[pos] == '&')
+                if(str[pos] == '&' && directives::match(str, pos).directive)
                 {
-                    if(pos + 1 < str.size())
-                    {
-                        if(str[pos + 1] == 'r')
-                        {
-                            return pos;
-                        }
-                        if(str[pos + 1] == '#' && pos + 8 <= str.size())
-                        {
-                            return pos;
-                        }
-                        std::string candidate = str.substr(pos, 2);
-                        for(const auto& cmd : IGNORED_COMMANDS)
-                        {
-                            if(candidate == cmd)
-                            {
-                                return pos;
-                            }
-                        }
-                    }
+                    return pos;
                 }
                 pos++;
             }
             return str.size();
         };
 
+        auto add_color = [](Text& segment, std::string_view hex) -> bool {
+            gradient::rgb color;
+            if(!gradient::parse_rgb(hex, color)) return false;
+            segment.colors.push_back(color);
+            return true;
+        };
+
         std::vector<Text> cases;
         size_t status = 0;
+        size_t output_size = text.size();
 
         while(status != std::string::npos)
         {
@@ -155,83 +123,80 @@ namespace raw
             if(status == std::string::npos) break;
 
             Text segment;
-            segment.start = static_cast<int>(status);
+            segment.start = status;
             size_t end_pos = text.find("\"", status + 12);
             if(end_pos == std::string::npos) break;
 
             size_t next_gradient = text.find("&@gradient:\"", status + 1);
             segment.end = (next_gradient == std::string::npos) ? text.size() - 1 : next_gradient - 1;
-            segment.text = text.substr(segment.start, segment.end - segment.start + 1);
+            std::string_view segment_text = std::string_view(text).substr(segment.start, segment.end - segment.start + 1);
 
-            if(segment.text.size() < 15)
+            if(segment_text.size() < 15)
             {
                 status = segment.end + 1;
                 continue;
             }
-            std::cout << segment.text.substr(12, 1) << std::flush;
-            segment.type = std::stoi(segment.text.substr(12, 1));
+            char type_code = segment_text[12];
+            segment.type = (type_code >= '0' && type_code <= '9') ? type_code - '0' : -1;
 
             switch(segment.type)
             {
                 case 1:
-                    if(segment.text.size() < 30)
+                    if(segment_text.size() < 30 ||
+                       !add_color(segment, segment_text.substr(15, 6)) ||
+                       !add_color(segment, segment_text.substr(23, 6)))
                     {
                         segment.type = -1;
-                        break;
                     }
-                    segment.colors.emplace_back(segment.text.substr(15, 6));
-                    segment.colors.emplace_back(segment.text.substr(23, 6));
                     break;
                 case 2:
-                    if(segment.text.size() < 22)
+                    if(segment_text.size() < 22)
                     {
                         segment.type = -1;
                         break;
                     }
                     {
                         size_t color_pos = 15;
-                        while(color_pos + 6 <= segment.text.size())
+                        while(color_pos + 6 <= segment_text.size())
                         {
-                            segment.colors.emplace_back(segment.text.substr(color_pos, 6));
+                            if(!add_color(segment, segment_text.substr(color_pos, 6))) break;
                             color_pos += 8;
-                            if(color_pos >= segment.text.size() || segment.text[color_pos - 1] != '#') break;
+                            if(color_pos >= segment_text.size() || segment_text[color_pos - 1] != '#') break;
                         }
+                        if(segment.colors.empty()) segment.type = -1;
                     }
                     break;
                 case 3: {
-                    if(segment.text.size() < 22)
+                    if(segment_text.size() < 22 || !add_color(segment, segment_text.substr(15, 6)))
                     {
                         segment.type = -1;
                         break;
                     }
-                    //first color 
-                    std::string first_color = segment.text.substr(15, 6);
-                    segment.colors.emplace_back(first_color);
                     
                     //check the closing "
-                    size_t content_start = segment.text.find("\"", 14) + 1;
+                    size_t content_start = segment_text.find("\"", 14);
                     if(content_start == std::string::npos) break;
+                    content_start++;
 
                     // Buscar próximos códigos de color
-                    size_t color_pos = segment.text.find("&", content_start);
+                    size_t color_pos = segment_text.find("&", content_start);
 
-                    if(color_pos != std::string::npos && color_pos < static_cast<size_t>(segment.end))
+                    if(color_pos != std::string::npos && color_pos + 1 < segment_text.size())
                     {
-                        if(segment.text.substr(color_pos, 2) == "&r") //we found nothing
+                        if(segment_text[color_pos + 1] == 'r') //we found nothing
                         {
                             break;
                         }
                         //hex colors
-                        else if(segment.text.substr(color_pos, 2) == "&#" && color_pos + 8 <= static_cast<size_t>(segment.end))
+                        else if(segment_text[color_pos + 1] == '#' && color_pos + 8 <= segment_text.size())
                         {
-                            segment.colors.emplace_back(segment.text.substr(color_pos + 2, 6));
+                            add_color(segment, segment_text.substr(color_pos + 2, 6));
                         }
                         //letters
-                        else if(color_pos + 1 < static_cast<size_t>(segment.end))
+                        else if(const directives::Directive* d = directives::find_code(segment_text[color_pos + 1]);
+                                d && d->kind == directives::Kind::COLOR)
                         {
-                            segment.colors.emplace_back(
-                                get_color(segment.text.substr(color_pos, 1))
-                            );
+                            add_color(segment, d->json);
                         }
                     }
                 }
@@ -243,95 +208,134 @@ namespace raw
 
             if(segment.type != -1)
             {
-                cases.emplace_back(segment);
+                size_t content_start = segment_text.find("\"", 12);
+                if(content_start != std::string::npos)
+                {
+                    segment.content_start = segment.start + content_start + 1;
+                    segment.limit = find_limit(std::string_view(text).substr(segment.content_start, segment.end + 1 - segment.content_start));
+
+                    //header goes away, every colored character gains "&#RRGGBB"
+                    output_size -= segment.content_start - segment.start;
+                    output_size += segment.colors.size() == 1 ? 8 : segment.limit * 8;
+                    status = segment.end + 1;
+                    cases.emplace_back(std::move(segment));
+                    continue;
+                }
             }
             status = segment.end + 1;
         }
 
-        //last to start, why? because we will change stuff
-        std::string text_input = text;
-        for(int i = cases.size() - 1; i >= 0; i--)
-        {
-            auto& c = cases[i];
-            size_t content_start = c.text.find("\"", 12) + 1;
-            if (content_start == std::string::npos) continue;
+        if(cases.empty()) return text;
 
-            std::string content = c.text.substr(content_start);
-            size_t limit = find_limit(content);
-            std::string text_to_color = content.substr(0, limit);
-            std::string remaining_text = content.substr(limit);
+        std::string text_input;
+        text_input.reserve(output_size);
+        size_t copied = 0;
+        for(const auto& c : cases)
+        {
+            text_input.append(text, copied, c.start - copied);
+            std::string_view text_to_color = std::string_view(text).substr(c.content_start, c.limit);
 
-            std::string colored_text;
             if(c.colors.size() == 1)
             {
-                colored_text = "&#" + c.colors[0] + text_to_color;
+                text_input += "&#";
+                size_t at = text_input.size();
+                text_input.resize(at + 6);
+                gradient::write_hex(text_input.data() + at, c.colors[0]);
+                text_input += text_to_color;
             }
             else
             {
-                size_t length = text_to_color.size();
-                for(size_t j = 0; j < length; j++)
-                {
-                    float t = static_cast<float>(j) / (length - 1);
-                    float segment = t * (c.colors.size() - 1);
-                    int color_index = static_cast<int>(segment);
-                    if(static_cast<size_t>(color_index) >= c.colors.size() - 1)
-                    {
-                        colored_text += "&#" + c.colors.back() + text_to_color[j];
-                    }
-                    else
-                    {
-                        float segment_t = segment - color_index;
-                        std::string color = interpolate_color(
-                            c.colors[color_index],
-                            c.colors[color_index + 1],
-                            segment_t
-                        );
-                        colored_text += "&#" + color + text_to_color[j];
-                    }
-                }
+                gradient::apply(text_input, text_to_color, c.colors.data(), c.colors.size(), mode, delta_e);
             }
 
-            std::string new_segment = colored_text + remaining_text;
-            text_input.replace(c.start, c.end - c.start + 1, new_segment);
+            //whatever is after the limit stays as it is
+            copied = c.content_start + c.limit;
         }
+        text_input.append(text, copied);
 
         return text_input;
     }
 
-    inline std::string json_escape(const std::string& str)
+    //Appends str escaped for a JSON string (without the quotes)
+    inline void json_escape_to(std::string& out, std::string_view str)
+    {
+        utils::append_escaped(out, str, utils::EscapeStyle::JSON);
+    }
+
+    inline std::string json_escape(std::string_view str)
     {
-        std::ostringstream oss;
-        for(char c : str)
+        std::string out;
+        out.reserve(str.size());
+        json_escape_to(out, str);
+        return out;
+    }
+
+    namespace detail
+    {
+        /**
+         * @brief Writes the components of to_json straight into one buffer
+         * The layout depends on the mode:
+         * array -> [c0,c1,c2]
+         * extra -> c0 without its closing brace,"extra":[c1,c2]}
+         * offsets keeps where every component starts, no component gets its own string
+         */
+        struct ComponentWriter
         {
-            switch (c)
+            std::string out;
+            std::vector<size_t> offsets;
+            bool use_extra;
+
+            ComponentWriter(bool use_extra, size_t expected) : use_extra(use_extra)
             {
-                case '"': oss << "\\\""; break;
-                case '\\': oss << "\\\\"; break;
-                case '\b': oss << "\\b"; break;
-                case '\f': oss << "\\f"; break;
-                case '\n': oss << "\\n"; break;
-                case '\r': oss << "\\r"; break;
-                case '\t': oss << "\\t"; break;
-                default:
-                    if(static_cast<unsigned char>(c) <= 0x1F)
-                    {
-                        oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') 
-                            << static_cast<int>(c);
-                    }
-                    else
-                    {
-                        oss << c;
-                    }
+                out.reserve(expected);
+                if(!use_extra) out += '[';
             }
-        }
-        return oss.str();
+
+            //Opens a new component, the caller writes it whole on the returned buffer
+            std::string& begin()
+            {
+                if(use_extra && offsets.size() == 1)
+                {
+                    out.pop_back(); //closing brace of the first one, the rest go inside it
+                    out += ",\"extra\":[";
+                }
+                else if(!offsets.empty())
+                {
+                    out += ',';
+                }
+                offsets.push_back(out.size());
+                return out;
+            }
+
+            size_t count() const
+            {
+                return offsets.size();
+            }
+
+            //Closes the layout, needs at least one component
+            std::string finish()
+            {
+                if(!use_extra)
+                {
+                    out += ']';
+                }
+                else if(offsets.size() == 1)
+                {
+                    //a lonely component is always an array
+                    out.insert(out.begin(), '[');
+                    out += ']';
+                }
+                else
+                {
+                    out += "]}";
+                }
+                return std::move(out);
+            }
+        };
     }
 
-    inline std::string to_json(std::string& input, bool use_extra = false)
+    namespace detail
     {
-        std::string text_input = change_gradient(input);
-        if(!check_non_ftb(text_input)) return text_input;
-
         struct State
         {
             std::string color;  // Vacío por defecto en lugar de "#FFFFFF"
@@ -340,324 +344,477 @@ namespace raw
             bool underlined = false;
             bool strikethrough = false;
             bool obfuscated = false;
+            //owned, a state outlives the text it was parsed from (streamed pieces, cached segments)
             std::string click_action;
             std::string click_value;
             std::string hover_action;
             std::string hover_value;
             std::string shadow;
-        };
 
-        std::vector<std::string> components;
-        State current_state;
-        std::string current_text;
-        bool has_formatting = false;
+            bool operator==(const State&) const = default;
+        };
 
-        auto flush_text = [&]() {
-            if (current_text.empty()) return;
+        //One {"text":...} of the output, before it's written
+        struct Component
+        {
+            State state;
+            size_t text_begin; //inside Components::text
+            size_t text_end;
+            bool page_break = false;
+        };
 
-            std::ostringstream oss;
-            oss << "{";
-            oss << "\"text\":\"" << json_escape(current_text) << "\"";
-            
-            auto has_extra_properties = [](const State& s) -> bool {
-                return (s.color != "#FFFFFF") ||
-                    s.bold ||
-                    s.italic ||
-                    s.underlined ||
-                    s.strikethrough ||
-                    s.obfuscated ||
-                    !s.click_action.empty() ||
-                    !s.hover_action.empty() ||
-                    !s.shadow.empty();
-            };
+        /**
+         * @brief Intermediate representation of to_json
+         * The text of every component is stored back to back in text
+         */
+        struct Components
+        {
+            std::string text;
+            std::vector<Component> list;
+            bool has_formatting = false;
 
-            // Verificar si es el primer componente y tiene propiedades extra
-            if(components.empty() && has_extra_properties(current_state))
+            std::string_view textOf(const Component& c) const
             {
-                components.push_back("{\"text\":\"\"}");
+                return std::string_view(text).substr(c.text_begin, c.text_end - c.text_begin);
             }
+        };
+
+        inline bool has_extra_properties(const State& s)
+        {
+            return (s.color != "#FFFFFF") ||
+                s.bold ||
+                s.italic ||
+                s.underlined ||
+                s.strikethrough ||
+                s.obfuscated ||
+                !s.click_action.empty() ||
+                !s.hover_action.empty() ||
+                !s.shadow.empty();
+        }
+
+        /**
+         * @brief Writes {"text":...} with the properties of s
+         * Without parent only non default properties are written, with it only the ones that differ
+         * (children of a component inherit its style)
+         * If nothing is left and bare_text is set, it's written as a plain "text"
+         */
+        inline void write_component(std::string& out, std::string_view text, const State& s,
+                                    const State* parent = nullptr, bool bare_text = false)
+        {
+            static const State defaults;
+            const State& base = parent ? *parent : defaults;
+            const size_t start = out.size();
+
+            out += "{\"text\":\"";
+            json_escape_to(out, text);
+            out += '"';
+            const size_t plain_end = out.size();
+
             // Solo añadir propiedades si no son valores por defecto
-            if(!current_state.color.empty() && current_state.color != "#FFFFFF") {
-                oss << ",\"color\":\"" << current_state.color << "\"";
+            //white is treated as no color, unless it has to undo the parent one
+            if(!s.color.empty() && s.color != base.color && (!base.color.empty() || s.color != "#FFFFFF")) {
+                out += ",\"color\":\"";
+                out += s.color;
+                out += '"';
             }
 
-            if (current_state.bold) oss << ",\"bold\":true";
-            if (current_state.italic) oss << ",\"italic\":true";
-            if (current_state.underlined) oss << ",\"underlined\":true";
-            if (current_state.strikethrough) oss << ",\"strikethrough\":true";
-            if (current_state.obfuscated) oss << ",\"obfuscated\":true";
+            auto write_flag = [&](const char* key, bool value, bool inherited) {
+                if(value == inherited) return;
+                out += ",\"";
+                out += key;
+                out += value ? "\":true" : "\":false";
+            };
+            write_flag("bold", s.bold, base.bold);
+            write_flag("italic", s.italic, base.italic);
+            write_flag("underlined", s.underlined, base.underlined);
+            write_flag("strikethrough", s.strikethrough, base.strikethrough);
+            write_flag("obfuscated", s.obfuscated, base.obfuscated);
             
-            if (!current_state.shadow.empty()) {
-                oss << ",\"shadow_color\":" << current_state.shadow;
+            if (!s.shadow.empty() && s.shadow != base.shadow) {
+                out += ",\"shadow_color\":";
+                out += s.shadow;
             }
             
-            if (!current_state.click_action.empty()) {
-                oss << ",\"clickEvent\":{\"action\":\"" << current_state.click_action 
-                    << "\",\"value\":\"" << json_escape(current_state.click_value) << "\"}";
+            if (!s.click_action.empty() &&
+                (s.click_action != base.click_action || s.click_value != base.click_value)) {
+                out += ",\"clickEvent\":{\"action\":\"";
+                out += s.click_action;
+                out += "\",\"value\":\"";
+                json_escape_to(out, s.click_value);
+                out += "\"}";
             }
             
-            if (!current_state.hover_action.empty()) {
-                oss << ",\"hoverEvent\":{\"action\":\"" << current_state.hover_action << "\"";
-                if (current_state.hover_action == "show_item") {
-                    oss << ",\"contents\":{\"id\":\"" << json_escape(current_state.hover_value) 
-                        << "\",\"count\":1}";
+            if (!s.hover_action.empty() &&
+                (s.hover_action != base.hover_action || s.hover_value != base.hover_value)) {
+                out += ",\"hoverEvent\":{\"action\":\"";
+                out += s.hover_action;
+                out += '"';
+                if (s.hover_action == "show_item") {
+                    out += ",\"contents\":{\"id\":\"";
+                    json_escape_to(out, s.hover_value);
+                    out += "\",\"count\":1}";
                 } else {
-                    oss << ",\"contents\":{\"text\":\"" << json_escape(current_state.hover_value) << "\"}";
+                    out += ",\"contents\":{\"text\":\"";
+                    json_escape_to(out, s.hover_value);
+                    out += "\"}";
                 }
-                oss << "}";
+                out += '}';
             }
-            
-            oss << "}";
-            components.push_back(oss.str());
-            current_text.clear();
-            current_state.hover_action.clear();
-            current_state.hover_value.clear();
-            current_state.click_action.clear();
-            current_state.click_value.clear();
-            current_state.shadow.clear();
-        };
 
-        size_t i = 0;
-        while(i < text_input.size())
+            if(bare_text && out.size() == plain_end)
+            {
+                //{"text":"abc" -> "abc"
+                out.replace(start, 9, "\"");
+                return;
+            }
+            out += '}';
+        }
+
+        /**
+         * @brief Markup to components, text_input is the markup after change_gradient
+         * @param state Style at the start, receives the style at the end (for texts converted in pieces)
+         */
+        inline void parse_components(const std::string& text_input, Components& ir, State* state = nullptr)
         {
-            if(text_input[i] == '&' && (i + 1) < input.size())
+            ir.text.reserve(text_input.size());
+            //every component is closed by a command, so this is an upper bound
+            ir.list.reserve(std::count(text_input.begin(), text_input.end(), '&') + 1);
+            State current_state = state ? *state : State();
+            size_t text_begin = 0;
+
+            auto flush_text = [&]() {
+                if (ir.text.size() == text_begin) return;
+
+                ir.list.push_back({current_state, text_begin, ir.text.size()});
+                text_begin = ir.text.size();
+                current_state.hover_action.clear();
+                current_state.hover_value.clear();
+                current_state.click_action.clear();
+                current_state.click_value.clear();
+                current_state.shadow.clear();
+            };
+
+            size_t i = 0;
+            while(i < text_input.size())
             {
-                char code = input[i + 1];
-                if(code == 'r')
-                {
-                    flush_text();
-                    // Reset completo del estado (incluyendo eventos)
-                    current_state = State();
-                    has_formatting = true;
-                    i += 2;
-                    continue;
-                }
-                else if(code == 'l' || code == 'o' || code == 'n' || code == 'm' || code == 'k')
-                {
-                    flush_text();
-                    if (code == 'l') current_state.bold = true;
-                    else if (code == 'o') current_state.italic = true;
-                    else if (code == 'n') current_state.underlined = true;
-                    else if (code == 'm') current_state.strikethrough = true;
-                    else if (code == 'k') current_state.obfuscated = true;
-                    has_formatting = true;
-                    i += 2;
-                    continue;
-                }
-                else if((code >= '0' && code <= '9') || 
-                        (code >= 'a' && code <= 'f') || 
-                        (code >= 'A' && code <= 'F'))
-                {
-                    flush_text();
-                    int index;
-                    if(code >= '0' && code <= '9') index = code - '0';
-                    else if(code >= 'a' && code <= 'f') index = 10 + (code - 'a');
-                    else index = 10 + (code - 'A');
-                    current_state.color = COLOR_CODES[index];
-                    has_formatting = true;
-                    i += 2;
-                    continue;
-                }
-                else if(code == '#' && (i + 7) < text_input.size())
-                {
-                    flush_text();
-                    current_state.color = "#" + text_input.substr(i + 2, 6);
-                    has_formatting = true;
-                    i += 8;
-                    continue;
-                }
-                else if(code == '@' && (i + 2) < text_input.size())
+                const directives::Match command = text_input[i] == '&' ? directives::match(text_input, i) : directives::Match();
+                if(command.directive)
                 {
-                    size_t start = i + 2;
-                    size_t pos = start;
-                    std::string cmd;
-                    
-                    // Extraer el nombre del comando
-                    while(pos < text_input.size() && (std::isalpha(text_input[pos]) || text_input[pos] == '_'))
-                    {
-                        cmd += text_input[pos];
-                        pos++;
-                    }
-                    
-                    // Manejar comando de página sin parámetros
-                    if(cmd == "page")
+                    const directives::Directive& d = *command.directive;
+                    ir.has_formatting = true;
+
+                    //&& commands (hovers, shadows) belong to the text before them, everything else starts a new component
+                    if(d.prefix != '&')
                     {
                         flush_text();
-                        components.emplace_back("{\"text\":\"\\n{@pagebreak}\\n\"}");
-                        has_formatting = true;
-                        i = pos;
-                        continue;
                     }
-                    
-                    // Manejar comandos con parámetros entre comillas
-                    if(pos < text_input.size() && text_input[pos+1] == '"') 
+
+                    switch(d.kind)
                     {
-                        size_t end_quote = pos + 2;
-                        while(end_quote < text_input.size() && text_input[end_quote] != '"')
-                        {
-                            if(text_input[end_quote] == '\\' && end_quote + 1 < text_input.size())
-                            {
-                                end_quote++; // Saltar caracter de escape
-                            }
-                            end_quote++;
-                        }
-                        
-                        if(end_quote < text_input.size())
-                        {
-                            std::string value = text_input.substr(pos + 2, end_quote - pos - 2);
-                            flush_text();
-                            has_formatting = true;
-                            
-                            if(cmd == "url")
-                            {
-                                current_state.click_action = "open_url";
-                                current_state.click_value = value;
-                            }
-                            else if(cmd == "in")
-                            {
-                                current_state.click_action = "suggest_command";
-                                current_state.click_value = value;
-                            }
-                            else if(cmd == "file")
-                            {
-                                current_state.click_action = "open_file";
-                                current_state.click_value = value;
-                            }
-                            else if(cmd == "command")
-                            {
-                                current_state.click_action = "run_command";
-                                current_state.click_value = value;
-                            }
-                            else if(cmd == "copy")
+                        case directives::Kind::RESET:
+                            // Reset completo del estado (incluyendo eventos)
+                            current_state = State();
+                            break;
+                        case directives::Kind::FORMAT:
+                            switch(d.index)
                             {
-                                current_state.click_action = "copy_to_clipboard";
-                                current_state.click_value = value;
+                                case directives::BOLD: current_state.bold = true; break;
+                                case directives::ITALIC: current_state.italic = true; break;
+                                case directives::UNDERLINED: current_state.underlined = true; break;
+                                case directives::STRIKETHROUGH: current_state.strikethrough = true; break;
+                                case directives::OBFUSCATED: current_state.obfuscated = true; break;
                             }
-                            else if(cmd == "change")
+                            break;
+                        case directives::Kind::COLOR:
+                            current_state.color = d.json;
+                            break;
+                        case directives::Kind::HEX_COLOR:
+                            current_state.color.assign(1, '#');
+                            current_state.color += command.argument;
+                            break;
+                        case directives::Kind::CLICK:
+                            current_state.click_action = d.json;
+                            current_state.click_value = command.argument;
+                            break;
+                        case directives::Kind::PAGE:
+                            ir.list.push_back({State(), text_begin, text_begin, true});
+                            break;
+                        case directives::Kind::HOVER:
+                            current_state.hover_action = d.json;
+                            current_state.hover_value = command.argument;
+                            break;
+                        case directives::Kind::SHADOW:
+                            if(command.argument.length() == 9 && command.argument[0] == '#')
                             {
-                                current_state.click_action = "change_page";
-                                current_state.click_value = value;
+                                // #AARRGGBB
+                                std::string argb_hex(command.argument.substr(1));
+                                current_state.shadow = std::to_string(argb_hex_to_decimal(argb_hex));
                             }
-                            
-                            i = end_quote + 1;
-                            continue;
-                        }
+                            break;
+                        case directives::Kind::GRADIENT:
+                        case directives::Kind::UNKNOWN:
+                            break;
                     }
+                    i += command.length;
+                    continue;
                 }
-                else if(code == '&' && (i + 2) < text_input.size())
+                ir.text += text_input[i];
+                i++;
+            }
+            flush_text();
+            if(state) *state = current_state;
+        }
+
+        /**
+         * @brief Components as they come, the way it always worked
+         * An empty component is added first when the first one has any style, so it isn't inherited
+         */
+        inline std::string write_components(const Components& ir, bool use_extra)
+        {
+            ComponentWriter writer(use_extra, ir.text.size() * 4 + 32);
+            for(const auto& c : ir.list)
+            {
+                if(c.page_break)
                 {
-                    // Manejo de eventos hover
-                    size_t start = i + 2;
-                    size_t pos = start;
-                    std::string cmd;
+                    writer.begin() += "{\"text\":\"\\n{@pagebreak}\\n\"}";
+                    continue;
+                }
+                if(writer.count() == 0 && has_extra_properties(c.state))
+                {
+                    writer.begin() += "{\"text\":\"\"}";
+                }
+                write_component(writer.begin(), ir.textOf(c), c.state);
+            }
+            return writer.finish();
+        }
 
-                    while(pos < text_input.size() && (std::isalpha(text_input[pos]) || text_input[pos] == '_'))
+        /**
+         * @brief Glues together neighbours that look the same
+         * Gradients that repeat a color or text split by a command that changes nothing end up as one component
+         */
+        inline void merge_components(Components& ir)
+        {
+            size_t kept = 0;
+            for(size_t i = 0; i < ir.list.size(); i++)
+            {
+                Component& c = ir.list[i];
+                if(kept > 0)
+                {
+                    Component& last = ir.list[kept - 1];
+                    if(!c.page_break && !last.page_break && last.state == c.state && last.text_end == c.text_begin)
                     {
-                        cmd += text_input[pos];
-                        pos++;
+                        last.text_end = c.text_end;
+                        continue;
                     }
+                }
+                if(kept != i) ir.list[kept] = std::move(c);
+                kept++;
+            }
+            ir.list.resize(kept);
+        }
 
-                    if(pos < text_input.size() && text_input[pos+1] == '"')
-                    {
-                        size_t end_quote = pos + 2;
-                        while(end_quote < text_input.size())
-                        {
-                            if(text_input[end_quote] == '\\' && end_quote + 1 < text_input.size())
-                            {
-                                end_quote += 2;
-                            }
-                            else if(text_input[end_quote] == '"')
-                            {
-                                break;
-                            }
-                            else
-                            {
-                                end_quote++;
-                            }
-                        }
+        /**
+         * @brief Smallest serialization of the components
+         * Everything that all of them share goes to the parent (first element / extra holder) once,
+         * children only write what differs. Then array or extra is picked by size,
+         * and unstyled components are written as plain strings
+         */
+        inline std::string write_minimized(Components& ir)
+        {
+            merge_components(ir);
 
-                        if(end_quote < text_input.size() && text_input[end_quote] == '"')
-                        {
-                            std::string value = text_input.substr(pos + 2, end_quote - pos - 2);
-                            has_formatting = true;
+            //Style shared by every text component, page breaks don't care
+            State common;
+            bool first = true;
+            for(const auto& c : ir.list)
+            {
+                if(c.page_break) continue;
+                if(first)
+                {
+                    common = c.state;
+                    first = false;
+                    continue;
+                }
+                if(common.color != c.state.color) common.color.clear();
+                common.bold = common.bold && c.state.bold;
+                common.italic = common.italic && c.state.italic;
+                common.underlined = common.underlined && c.state.underlined;
+                common.strikethrough = common.strikethrough && c.state.strikethrough;
+                common.obfuscated = common.obfuscated && c.state.obfuscated;
+                if(common.shadow != c.state.shadow) common.shadow.clear();
+                if(common.click_action != c.state.click_action || common.click_value != c.state.click_value)
+                {
+                    common.click_action = {};
+                    common.click_value = {};
+                }
+                if(common.hover_action != c.state.hover_action || common.hover_value != c.state.hover_value)
+                {
+                    common.hover_action = {};
+                    common.hover_value = {};
+                }
+            }
 
-                            if(cmd == "text")
-                            {
-                                current_state.hover_action = "show_text";
-                                current_state.hover_value = value;
-                            }
-                            else if(cmd == "item")
-                            {
-                                current_state.hover_action = "show_item";
-                                current_state.hover_value = value;
-                            }
-                            else if(cmd == "shadow")
-                            {
-                                if (value.length() >= 1 && value[0] == '#' && value.length() == 9) {
-                                    // #AARRGGBB
-                                    std::string argb_hex = value.substr(1);
-                                    unsigned int shadow_decimal = argb_hex_to_decimal(argb_hex);
-                                    current_state.shadow = std::to_string(shadow_decimal);
-                                }
-                            }
+            //The first component can be the parent itself if it has nothing of its own
+            size_t children_begin = 0;
+            std::string_view parent_text;
+            if(!ir.list.empty() && !ir.list[0].page_break && ir.list[0].state == common)
+            {
+                parent_text = ir.textOf(ir.list[0]);
+                children_begin = 1;
+            }
 
-                            i = end_quote + 1;
-                            continue;
-                        }
-                    }
-                }
+            std::string children;
+            children.reserve(ir.text.size() * 2 + 16);
+            for(size_t i = children_begin; i < ir.list.size(); i++)
+            {
+                if(i > children_begin) children += ',';
+                const Component& c = ir.list[i];
+                if(c.page_break) children += "\"\\n{@pagebreak}\\n\"";
+                else write_component(children, ir.textOf(c), c.state, &common, true);
             }
-            current_text += text_input[i];
-            i++;
-        }
-        flush_text();
 
-        if(!has_formatting)
-        {
-            return "\"" + json_escape(text_input) + "\"";
-        }
-        else if(components.empty())
-        {
-            return "\"\"";
+            std::string parent;
+            write_component(parent, parent_text, common, nullptr, true);
+            const bool bare_parent = parent.front() == '"';
+
+            if(children.empty())
+            {
+                return parent;
+            }
+
+            //[parent,children] against {parent,"extra":[children]}
+            const size_t array_size = parent.size() + children.size() + 3;
+            const size_t extra_size = bare_parent ? std::string::npos : parent.size() + children.size() + 11;
+
+            std::string out;
+            if(array_size <= extra_size)
+            {
+                out.reserve(array_size);
+                out += '[';
+                out += parent;
+                out += ',';
+                out += children;
+                out += ']';
+            }
+            else
+            {
+                out.reserve(extra_size);
+                out.append(parent, 0, parent.size() - 1);
+                out += ",\"extra\":[";
+                out += children;
+                out += "]}";
+            }
+            return out;
         }
-        else if(components.size() == 1)
+    }
+
+    //Goes up whenever the same input would give a different output, cached results of older versions don't match
+    inline constexpr uint32_t CONVERTER_VERSION = 1;
+
+    struct Options
+    {
+        bool use_extra = false; //{"extra":[...]} instead of [...]
+        gradient::Mode gradient = gradient::Mode::SRGB;
+        bool minimize = false; //merge, inherit and pick the smallest layout (use_extra is ignored)
+        float delta_e = 0.0f; //gradient characters closer than this (OKLab * 100, ~2 is hard to notice) share a color
+
+        bool operator==(const Options&) const = default;
+    };
+
+    //Size of a conversion, filled when asked to
+    struct Report
+    {
+        size_t original_bytes = 0; //without minimizing, in the requested layout
+        size_t output_bytes = 0;
+        size_t original_components = 0;
+        size_t output_components = 0;
+        //what the delta_e quantization saved on its own (0 without it)
+        size_t quantized_bytes = 0;
+        size_t quantized_components = 0;
+
+        //0 when the output grew (an extra parent can cost more than it saves on short texts)
+        size_t bytesSaved() const
         {
-            return "[" + components[0] + "]";
+            return original_bytes > output_bytes ? original_bytes - output_bytes : 0;
         }
-        else
+    };
+
+    namespace detail
+    {
+        //Everything to_json does once the components are known
+        inline std::string write_output(Components& ir, const Options& options, Report* report)
         {
-            if(use_extra)
+            std::string result;
+            if(!ir.has_formatting)
             {
-                std::string first_component = components[0];
-                
-                if(!first_component.empty() && first_component.back() == '}')
-                {
-                    first_component.pop_back();
-                }
+                //nothing was consumed, the text is the whole input
+                result = "\"" + json_escape(ir.text) + "\"";
+            }
+            else if(ir.list.empty())
+            {
+                result = "\"\"";
+            }
 
-                first_component += ",\"extra\":[";
-                for(size_t j = 1; j < components.size(); ++j)
-                {
-                    if(j > 1) first_component += ",";
-                    first_component += components[j];
-                }
-                first_component += "]}";
-                
-                return first_component;
+            if(!result.empty())
+            {
+                if(report) *report = {result.size(), result.size(), 0, 0};
+                return result;
             }
-            else //original
+
+            if(options.minimize)
             {
-                
-                std::string result = "[";
-                for(size_t j = 0; j < components.size(); ++j)
+                if(report)
+                {
+                    report->original_bytes = write_components(ir, options.use_extra).size();
+                    report->original_components = ir.list.size();
+                }
+                result = write_minimized(ir);
+                if(report)
                 {
-                    if(j > 0) result += ",";
-                    result += components[j];
+                    report->output_bytes = result.size();
+                    report->output_components = ir.list.size();
                 }
-                result += "]";
                 return result;
             }
+
+            result = write_components(ir, options.use_extra);
+            if(report) *report = {result.size(), result.size(), ir.list.size(), ir.list.size()};
+            return result;
+        }
+    }
+
+    inline std::string to_json(const std::string& input, const Options& options, Report* report = nullptr)
+    {
+        std::string text_input = change_gradient(input, options.gradient, options.delta_e);
+        std::string output;
+        if(!check_non_ftb(text_input))
+        {
+            if(report) *report = {text_input.size(), text_input.size(), 0, 0};
+            output = std::move(text_input);
         }
+        else
+        {
+            detail::Components ir;
+            detail::parse_components(text_input, ir);
+            output = detail::write_output(ir, options, report);
+        }
+
+        //the only way to know exactly is converting again without it
+        if(report && options.delta_e > 0.0f && input.contains("&@gradient:"))
+        {
+            Options exact = options;
+            exact.delta_e = 0.0f;
+            Report full;
+            to_json(input, exact, &full);
+            report->quantized_bytes = full.output_bytes - std::min(full.output_bytes, report->output_bytes);
+            report->quantized_components = full.output_components - std::min(full.output_components, report->output_components);
+        }
+        return output;
+    }
+
+    inline std::string to_json(const std::string& input, bool use_extra = false, gradient::Mode mode = gradient::Mode::SRGB)
+    {
+        return to_json(input, Options{use_extra, mode});
     }
 
     inline void hola()
@@ -681,7 +838,7 @@ namespace raw
                 << "- Run command (&@command:\"<command>\"), words after this will be affected\n"
                 << "- Copy to clipboard (&@copy:\"<text>\"), words after this will be affected\n"
                 << "- Change page (&@change:\"<value>\"), words after this will be affected\n"
-                << "- New page (&@page), acts as the new page on ftb\n"
+                << "- New page (&@page, &@page:\"\" when a word follows it), acts as the new page on ftb\n"
                 << "- Show text on hover (&&text:\"<text>\"), words before this will be affected\n"
                 << "- Show item on hover (&&item:\"<item_id>\"), words before this will be affected\n"
                 << "- Set shadow color (&&shadow:\"#AARRGGBB\"), words before this will be affected\n\n";
@@ -0,0 +1,752 @@
+#ifndef RAW_REVERSE_HPP
+#define RAW_REVERSE_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <parser/directives.h>
+#include <parser/gradient.h>
+#include <parser/raw.h>
+#include <utils/escape.h>
+#include <utils/utf8.h>
+
+namespace raw
+{
+namespace reverse
+{
+    class ParseError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    //Same order as COLOR_CODES, so the index is the & code
+    static const std::string_view COLOR_NAMES[16] = {
+        "black", "dark_blue", "dark_green", "dark_aqua", "dark_red", "dark_purple",
+        "gold", "gray", "dark_gray", "blue", "green", "aqua",
+        "red", "light_purple", "yellow", "white"
+    };
+
+    struct Style
+    {
+        std::string color; //#RRGGBB or empty
+        bool bold = false;
+        bool italic = false;
+        bool underlined = false;
+        bool strikethrough = false;
+        bool obfuscated = false;
+        bool has_shadow = false;
+        uint32_t shadow = 0; //ARGB
+        std::string click_action;
+        std::string click_value;
+        std::string hover_action;
+        std::string hover_value;
+
+        bool sameFormat(const Style& o) const
+        {
+            return bold == o.bold && italic == o.italic && underlined == o.underlined &&
+                   strikethrough == o.strikethrough && obfuscated == o.obfuscated;
+        }
+
+        bool hasEvents() const
+        {
+            return has_shadow || !click_action.empty() || !hover_action.empty();
+        }
+    };
+
+    struct Run
+    {
+        Style style;
+        std::string text;
+        bool page_break = false;
+    };
+
+    /**
+     * @brief Minimal JSON reader, enough to walk text components
+     * Works on the input directly, strings are the only thing copied
+     */
+    class Reader
+    {
+    private:
+        std::string_view input_;
+        size_t pos_ = 0;
+
+        [[noreturn]] void fail(const char* message) const
+        {
+            throw ParseError(std::string(message) + " at " + std::to_string(pos_));
+        }
+
+        uint32_t readHex4()
+        {
+            if(pos_ + 4 > input_.size()) fail("Truncated \\u escape");
+            const int32_t value = utils::read_hex4(input_.substr(pos_, 4));
+            if(value < 0) fail("Invalid \\u escape");
+            pos_ += 4;
+            return static_cast<uint32_t>(value);
+        }
+
+    public:
+        explicit Reader(std::string_view input) : input_(input) {}
+
+        size_t position() const noexcept { return pos_; }
+
+        std::string_view slice(size_t begin, size_t end) const { return input_.substr(begin, end - begin); }
+
+        void skipWhitespace() noexcept
+        {
+            while(pos_ < input_.size() &&
+                  (input_[pos_] == ' ' || input_[pos_] == '\n' || input_[pos_] == '\r' || input_[pos_] == '\t'))
+            {
+                pos_++;
+            }
+        }
+
+        char peek()
+        {
+            skipWhitespace();
+            return pos_ < input_.size() ? input_[pos_] : '\0';
+        }
+
+        bool atEnd()
+        {
+            return peek() == '\0' && pos_ >= input_.size();
+        }
+
+        void expect(char c)
+        {
+            if(peek() != c) fail("Unexpected character");
+            pos_++;
+        }
+
+        bool consume(char c)
+        {
+            if(peek() != c) return false;
+            pos_++;
+            return true;
+        }
+
+        void readString(std::string& out)
+        {
+            expect('"');
+            while(true)
+            {
+                //copy the clean part in one go
+                size_t start = pos_;
+                while(pos_ < input_.size() && input_[pos_] != '"' && input_[pos_] != '\\') pos_++;
+                out.append(input_, start, pos_ - start);
+
+                if(pos_ >= input_.size()) fail("Unterminated string");
+                if(input_[pos_++] == '"') return;
+
+                if(pos_ >= input_.size()) fail("Unterminated escape");
+                char e = input_[pos_++];
+                switch(e)
+                {
+                    case '"': out += '"'; break;
+                    case '\\': out += '\\'; break;
+                    case '/': out += '/'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'u': {
+                        uint32_t cp = readHex4();
+                        if(cp >= 0xDC00 && cp <= 0xDFFF) fail("Unpaired surrogate");
+                        if(cp >= 0xD800 && cp <= 0xDBFF)
+                        {
+                            if(pos_ + 1 >= input_.size() || input_[pos_] != '\\' || input_[pos_ + 1] != 'u')
+                            {
+                                fail("Unpaired surrogate");
+                            }
+                            pos_ += 2;
+                            uint32_t low = readHex4();
+                            if(low < 0xDC00 || low > 0xDFFF) fail("Unpaired surrogate");
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        utils::utf8::append(out, cp);
+                        break;
+                    }
+                    default: fail("Invalid escape");
+                }
+            }
+        }
+
+        std::string readString()
+        {
+            std::string out;
+            readString(out);
+            return out;
+        }
+
+        //Numbers, true, false and null as they are written
+        std::string_view readLiteral()
+        {
+            skipWhitespace();
+            size_t start = pos_;
+            while(pos_ < input_.size())
+            {
+                char c = input_[pos_];
+                if(c == ',' || c == '}' || c == ']' || c == ' ' || c == '\n' || c == '\r' || c == '\t') break;
+                pos_++;
+            }
+            if(start == pos_) fail("Expected a value");
+            return input_.substr(start, pos_ - start);
+        }
+
+        bool readBool()
+        {
+            std::string_view literal = readLiteral();
+            if(literal == "true") return true;
+            if(literal == "false") return false;
+            fail("Expected a boolean");
+        }
+
+        void skipValue()
+        {
+            char c = peek();
+            if(c == '"')
+            {
+                pos_++;
+                while(pos_ < input_.size() && input_[pos_] != '"')
+                {
+                    if(input_[pos_] == '\\') pos_++;
+                    pos_++;
+                }
+                if(pos_ >= input_.size()) fail("Unterminated string");
+                pos_++;
+            }
+            else if(c == '{' || c == '[')
+            {
+                char close = c == '{' ? '}' : ']';
+                pos_++;
+                if(consume(close)) return;
+                do
+                {
+                    if(close == '}')
+                    {
+                        readString();
+                        expect(':');
+                    }
+                    skipValue();
+                } while(consume(','));
+                expect(close);
+            }
+            else
+            {
+                readLiteral();
+            }
+        }
+    };
+
+    namespace detail
+    {
+        inline std::string normalizeColor(std::string_view color)
+        {
+            for(size_t i = 0; i < 16; i++)
+            {
+                if(color == COLOR_NAMES[i]) return COLOR_CODES[i];
+            }
+            gradient::rgb value;
+            if(gradient::parse_rgb(color, value))
+            {
+                std::string out = "#000000";
+                gradient::write_hex(out.data() + 1, value);
+                return out;
+            }
+            return ""; //reset or unknown, no color
+        }
+
+        //Text of a hover "contents", components are flattened to their plain text
+        inline void readPlainText(Reader& reader, std::string& out)
+        {
+            char c = reader.peek();
+            if(c == '"')
+            {
+                reader.readString(out);
+            }
+            else if(c == '[')
+            {
+                reader.expect('[');
+                if(reader.consume(']')) return;
+                do { readPlainText(reader, out); } while(reader.consume(','));
+                reader.expect(']');
+            }
+            else if(c == '{')
+            {
+                reader.expect('{');
+                if(reader.consume('}')) return;
+                do
+                {
+                    std::string key = reader.readString();
+                    reader.expect(':');
+                    if(key == "text" || key == "extra") readPlainText(reader, out);
+                    else reader.skipValue();
+                } while(reader.consume(','));
+                reader.expect('}');
+            }
+            else
+            {
+                out += reader.readLiteral();
+            }
+        }
+
+        inline void readClick(Reader& reader, Style& style)
+        {
+            std::string action;
+            std::string value;
+            reader.expect('{');
+            if(!reader.consume('}'))
+            {
+                do
+                {
+                    std::string key = reader.readString();
+                    reader.expect(':');
+                    if(key == "action") action = reader.readString();
+                    //value before 1.21.5, the rest after it
+                    else if(key == "value" || key == "url" || key == "command" || key == "path") value = reader.readString();
+                    else if(key == "page") value = reader.peek() == '"' ? reader.readString() : std::string(reader.readLiteral());
+                    else reader.skipValue();
+                } while(reader.consume(','));
+                reader.expect('}');
+            }
+            style.click_action = std::move(action);
+            style.click_value = std::move(value);
+        }
+
+        inline void readHover(Reader& reader, Style& style)
+        {
+            std::string action;
+            std::string value;
+            reader.expect('{');
+            if(!reader.consume('}'))
+            {
+                do
+                {
+                    std::string key = reader.readString();
+                    reader.expect(':');
+                    if(key == "action")
+                    {
+                        action = reader.readString();
+                    }
+                    else if(key == "contents" && reader.peek() == '{' && action == "show_item")
+                    {
+                        reader.expect('{');
+                        do
+                        {
+                            std::string item_key = reader.readString();
+                            reader.expect(':');
+                            if(item_key == "id") value = reader.readString();
+                            else reader.skipValue();
+                        } while(reader.consume(','));
+                        reader.expect('}');
+                    }
+                    else if(key == "contents" || key == "value" || key == "text")
+                    {
+                        readPlainText(reader, value);
+                    }
+                    else if(key == "id")
+                    {
+                        value = reader.readString();
+                    }
+                    else
+                    {
+                        reader.skipValue();
+                    }
+                } while(reader.consume(','));
+                reader.expect('}');
+            }
+            if(const directives::Directive* hover = directives::find_action(action);
+               hover && hover->kind == directives::Kind::HOVER)
+            {
+                style.hover_action = std::move(action);
+                style.hover_value = std::move(value);
+            }
+        }
+
+        inline void addText(std::vector<Run>& runs, const Style& style, std::string text)
+        {
+            if(text == "\n{@pagebreak}\n")
+            {
+                runs.push_back({Style(), {}, true});
+                return;
+            }
+            if(text.empty()) return;
+            runs.push_back({style, std::move(text), false});
+        }
+
+        /**
+         * @brief Flattens one component (and everything inside) into runs
+         * @return Style of the component, what its children and array siblings inherit
+         */
+        inline Style readComponent(Reader& reader, const Style& inherited, std::vector<Run>& runs)
+        {
+            char c = reader.peek();
+            if(c == '"')
+            {
+                addText(runs, inherited, reader.readString());
+                return inherited;
+            }
+
+            if(c == '[')
+            {
+                reader.expect('[');
+                if(reader.consume(']')) return inherited;
+                //the first element is the parent of the rest
+                Style parent = readComponent(reader, inherited, runs);
+                while(reader.consume(','))
+                {
+                    readComponent(reader, parent, runs);
+                }
+                reader.expect(']');
+                return inherited;
+            }
+
+            if(c != '{')
+            {
+                addText(runs, inherited, std::string(reader.readLiteral()));
+                return inherited;
+            }
+
+            Style style = inherited;
+            std::string text;
+            size_t extra_begin = 0;
+            size_t extra_end = 0;
+
+            reader.expect('{');
+            if(!reader.consume('}'))
+            {
+                do
+                {
+                    std::string key = reader.readString();
+                    reader.expect(':');
+
+                    if(key == "text") text = reader.readString();
+                    else if(key == "color") style.color = normalizeColor(reader.readString());
+                    else if(key == "bold") style.bold = reader.readBool();
+                    else if(key == "italic") style.italic = reader.readBool();
+                    else if(key == "underlined") style.underlined = reader.readBool();
+                    else if(key == "strikethrough") style.strikethrough = reader.readBool();
+                    else if(key == "obfuscated") style.obfuscated = reader.readBool();
+                    else if(key == "shadow_color" && reader.peek() != '[')
+                    {
+                        std::string_view literal = reader.readLiteral();
+                        int64_t value = 0;
+                        if(std::from_chars(literal.data(), literal.data() + literal.size(), value).ec != std::errc())
+                        {
+                            throw ParseError("Invalid shadow_color");
+                        }
+                        style.has_shadow = true;
+                        style.shadow = static_cast<uint32_t>(value);
+                    }
+                    else if(key == "clickEvent" || key == "click_event") readClick(reader, style);
+                    else if(key == "hoverEvent" || key == "hover_event") readHover(reader, style);
+                    else if(key == "extra")
+                    {
+                        //the style may come after extra, so it's read once the object is done
+                        extra_begin = reader.position();
+                        reader.skipValue();
+                        extra_end = reader.position();
+                    }
+                    else reader.skipValue();
+                } while(reader.consume(','));
+                reader.expect('}');
+            }
+
+            addText(runs, style, std::move(text));
+
+            if(extra_end > extra_begin)
+            {
+                Reader extra(reader.slice(extra_begin, extra_end));
+                extra.expect('[');
+                if(!extra.consume(']'))
+                {
+                    do { readComponent(extra, style, runs); } while(extra.consume(','));
+                    extra.expect(']');
+                }
+            }
+            return style;
+        }
+
+        //Writes :"value" for a & command, the forward parser keeps what's between the quotes as is
+        //(a backslash only hides the next character from the closing quote search)
+        inline void writeArgument(std::string& out, std::string_view value)
+        {
+            for(size_t i = 0; i < value.size(); i++)
+            {
+                if(value[i] == '"' || (value[i] == '\\' && ++i == value.size()))
+                {
+                    throw ParseError("Event value \"" + std::string(value) + "\" can't be written as markup");
+                }
+            }
+            out += ":\"";
+            out += value;
+            out += '"';
+        }
+
+        inline void writeColor(std::string& out, const std::string& color)
+        {
+            for(size_t i = 0; i < 16; i++)
+            {
+                if(color == COLOR_CODES[i])
+                {
+                    out += '&';
+                    out += "0123456789abcdef"[i];
+                    return;
+                }
+            }
+            out += "&#";
+            out.append(color, 1, 6);
+        }
+
+        //A single visible character that can be given to &@gradient as it is
+        inline bool gradientChar(const Run& run)
+        {
+            return !run.page_break && !run.text.empty() &&
+                   utils::utf8::next_cluster(run.text, 0) == run.text.size() &&
+                   run.text[0] != '&' && run.text[0] != '\\' && run.text[0] != '"' &&
+                   !run.style.color.empty() && !run.style.hasEvents();
+        }
+
+        /**
+         * @brief Stops of a gradient that reproduces colors within 1 per channel, empty if none does
+         * Tries 2 stops and then evenly spaced extra stops (gradient type 2)
+         */
+        inline std::vector<gradient::rgb> fitGradient(const std::vector<gradient::rgb>& colors)
+        {
+            const size_t length = colors.size();
+            gradient::rgb sampled[gradient::BLOCK_SIZE];
+            for(size_t stop_count = 2; stop_count <= 5 && stop_count <= length; stop_count++)
+            {
+                std::vector<gradient::rgb> stops(stop_count);
+                for(size_t s = 0; s < stop_count; s++)
+                {
+                    stops[s] = colors[(s * (length - 1) + (stop_count - 1) / 2) / (stop_count - 1)];
+                }
+
+                bool fits = true;
+                for(size_t first = 0; first < length && fits; first += gradient::BLOCK_SIZE)
+                {
+                    const size_t count = std::min(gradient::BLOCK_SIZE, length - first);
+                    gradient::sample(stops.data(), stop_count, length, first, count, gradient::Mode::SRGB, sampled);
+                    for(size_t j = 0; j < count && fits; j++)
+                    {
+                        for(int shift = 0; shift <= 16; shift += 8)
+                        {
+                            int a = static_cast<int>((sampled[j] >> shift) & 0xFF);
+                            int b = static_cast<int>((colors[first + j] >> shift) & 0xFF);
+                            if(a - b > 1 || b - a > 1) fits = false;
+                        }
+                    }
+                }
+                if(fits) return stops;
+            }
+            return {};
+        }
+
+        /**
+         * @brief Runs back to markup
+         * Styles only stack in the markup, so turning something off means &r and applying the rest again
+         * Clicks go before their text, hovers and shadows after it (that's how raw reads them)
+         */
+        inline std::string writeMarkup(const std::vector<Run>& runs, bool collapse_gradients)
+        {
+            std::string out;
+            Style markup; //what the converter will have when it reaches this point
+            bool needs_flush = false; //last text has events that must not reach the next one
+            bool needs_reset = false; //a gradient is still open
+            std::vector<size_t> pages; //where every &@page ends
+            std::vector<std::pair<size_t, size_t>> texts; //text written as it is, checked once everything after it is there
+
+            size_t i = 0;
+            while(i < runs.size())
+            {
+                const Run& run = runs[i];
+                if(run.page_break)
+                {
+                    if(needs_reset)
+                    {
+                        out += "&r";
+                        markup = Style();
+                        needs_reset = false;
+                    }
+                    out += "&@page";
+                    pages.push_back(out.size());
+                    needs_flush = false;
+                    i++;
+                    continue;
+                }
+
+                const Style& want = run.style;
+
+                //how many of the next runs are one colored character each, same format
+                size_t gradient_end = i;
+                std::vector<gradient::rgb> stops;
+                //a type 2 header reads #RRGGBB right after its quote as one more stop, # can't start the text
+                if(collapse_gradients && gradientChar(run) && run.text[0] != '#')
+                {
+                    std::vector<gradient::rgb> colors;
+                    while(gradient_end < runs.size() && gradientChar(runs[gradient_end]) &&
+                          runs[gradient_end].style.sameFormat(want))
+                    {
+                        gradient::rgb color = 0;
+                        gradient::parse_rgb(runs[gradient_end].style.color, color);
+                        colors.push_back(color);
+                        gradient_end++;
+                    }
+                    //longest start that still is a gradient
+                    while(colors.size() >= 3)
+                    {
+                        stops = fitGradient(colors);
+                        if(!stops.empty()) break;
+                        colors.resize(colors.size() / 2);
+                    }
+                    gradient_end = stops.empty() ? i : i + colors.size();
+                }
+
+                bool command = false;
+                if(needs_reset ||
+                   (markup.bold && !want.bold) || (markup.italic && !want.italic) ||
+                   (markup.underlined && !want.underlined) || (markup.strikethrough && !want.strikethrough) ||
+                   (markup.obfuscated && !want.obfuscated) || (!markup.color.empty() && want.color.empty()))
+                {
+                    out += "&r";
+                    markup = Style();
+                    needs_reset = false;
+                    command = true;
+                }
+
+                if(stops.empty() && !want.color.empty() && want.color != markup.color)
+                {
+                    writeColor(out, want.color);
+                    markup.color = want.color;
+                    command = true;
+                }
+
+                auto flag = [&](bool wanted, bool& current, const char* code) {
+                    if(wanted && !current)
+                    {
+                        out += code;
+                        current = true;
+                        command = true;
+                    }
+                };
+                flag(want.bold, markup.bold, "&l");
+                flag(want.italic, markup.italic, "&o");
+                flag(want.underlined, markup.underlined, "&n");
+                flag(want.strikethrough, markup.strikethrough, "&m");
+                flag(want.obfuscated, markup.obfuscated, "&k");
+
+                if(const directives::Directive* click = directives::find_action(want.click_action);
+                   click && click->kind == directives::Kind::CLICK)
+                {
+                    out += "&@";
+                    out += click->name;
+                    writeArgument(out, want.click_value);
+                    command = true;
+                }
+
+                if(needs_flush && !command)
+                {
+                    //something that closes the text and changes nothing
+                    if(!markup.color.empty()) writeColor(out, markup.color);
+                    else if(markup.bold) out += "&l";
+                    else if(markup.italic) out += "&o";
+                    else if(markup.underlined) out += "&n";
+                    else if(markup.strikethrough) out += "&m";
+                    else if(markup.obfuscated) out += "&k";
+                    else out += "&r";
+                }
+
+                if(!stops.empty())
+                {
+                    out += stops.size() == 2 ? "&@gradient:\"1" : "&@gradient:\"2";
+                    for(gradient::rgb stop : stops)
+                    {
+                        out += ",#";
+                        size_t at = out.size();
+                        out.resize(at + 6);
+                        gradient::write_hex(out.data() + at, stop);
+                    }
+                    out += '"';
+                    const size_t text_begin = out.size();
+                    for(size_t j = i; j < gradient_end; j++) out += runs[j].text;
+                    texts.emplace_back(text_begin, out.size());
+                    needs_reset = true;
+                    needs_flush = false;
+                    i = gradient_end;
+                    continue;
+                }
+
+                texts.emplace_back(out.size(), out.size() + run.text.size());
+                out += run.text;
+
+                if(want.has_shadow)
+                {
+                    static constexpr char digits[] = "0123456789ABCDEF";
+                    out += "&&shadow:\"#";
+                    for(int shift = 28; shift >= 0; shift -= 4) out += digits[(want.shadow >> shift) & 0xF];
+                    out += '"';
+                }
+                if(const directives::Directive* hover = directives::find_action(want.hover_action))
+                {
+                    out += "&&";
+                    out += hover->name;
+                    writeArgument(out, want.hover_value);
+                }
+                needs_flush = want.hasEvents();
+                i++;
+            }
+            //markup has no escape for &, text where it starts a command would come back changed (Tom&amp -> &a)
+            for(const auto& [begin, end] : texts)
+            {
+                for(size_t at = out.find('&', begin); at < end; at = out.find('&', at + 1))
+                {
+                    if(directives::match(out, at).directive)
+                    {
+                        throw ParseError("Text \"" + out.substr(begin, end - begin) + "\" has an & command in it, it can't be written as markup");
+                    }
+                }
+            }
+            //text starting with a letter after a page break would read as part of its name
+            for(auto it = pages.rbegin(); it != pages.rend(); ++it)
+            {
+                if(directives::needs_close(out, *it)) out.insert(*it, directives::BARE_CLOSE);
+            }
+            return out;
+        }
+    }
+
+    //Components of a JSON text, flattened in reading order with their final style
+    inline std::vector<Run> read_runs(std::string_view json)
+    {
+        std::vector<Run> runs;
+        Reader reader(json);
+        detail::readComponent(reader, Style(), runs);
+        if(!reader.atEnd()) throw ParseError("Unexpected trailing characters");
+        return runs;
+    }
+}
+
+    /**
+     * @brief JSON text component (string, array or extra tree) back to & markup
+     * Per character hex colors that follow a straight line become &@gradient again
+     * Text that isn't JSON (FTB's own & strings, what to_json leaves alone) is already markup
+     * Throws reverse::ParseError on invalid JSON and on what markup can't hold: an unescaped " in an event value
+     * or text where an & would start a command
+     */
+    inline std::string from_json(std::string_view json, bool collapse_gradients = true)
+    {
+        size_t first = json.find_first_not_of(" \n\r\t");
+        if(first == std::string_view::npos || (json[first] != '"' && json[first] != '[' && json[first] != '{'))
+        {
+            return std::string(json);
+        }
+        return reverse::detail::writeMarkup(reverse::read_runs(json), collapse_gradients);
+    }
+}
+
+#endif
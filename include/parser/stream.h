@@ -0,0 +1,193 @@
+#ifndef RAW_STREAM_HPP
+#define RAW_STREAM_HPP
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <parser/directives.h>
+#include <parser/raw.h>
+
+namespace raw
+{
+    /**
+     * @brief to_json for texts too big to hold: markup goes in a chunk at a time, components come out as they're done
+     * The text is cut right before commands that start a new component anyway (everything but && ones),
+     * each piece is converted with the style the last one ended with, so the output is the one to_json gives
+     * Memory is the biggest piece, not the text: a piece is the text between two such commands
+     * (a gradient and its text are always one piece)
+     *
+     * Differences with to_json: the output is always JSON (to_json leaves texts FTB can show as they are)
+     * and options.minimize is ignored, it needs the whole text
+     */
+    class StreamConverter
+    {
+    private:
+        std::ostream& out;
+        Options options;
+        size_t max_pending;
+
+        std::string pending; //markup not converted yet
+        detail::State state;
+        std::string component; //scratch for the one being written
+        std::string first; //extra layout: the first component waits to know if it's the parent
+        size_t components = 0;
+        bool finished = false;
+
+        /**
+         * @brief Position of the last place the text can be cut, 0 if there's none
+         * open receives where a command still waiting for its closing quote starts (npos if none),
+         * nothing after it is looked at: an &r inside &@url:"...&r..." isn't a command
+         */
+        size_t findCut(bool& has_gradient, size_t& open) const
+        {
+            size_t cut = 0;
+            bool after_gradient = false;
+            has_gradient = false;
+            open = std::string::npos;
+            size_t i = pending.find('&');
+            while(i != std::string::npos && i + 1 < pending.size())
+            {
+                const directives::Match command = directives::match(pending, i);
+                if(!command.directive)
+                {
+                    if(pending[i + 1] == '@' || pending[i + 1] == '&')
+                    {
+                        size_t end = i + 2;
+                        while(end < pending.size() && directives::detail::nameChar(pending[end])) end++;
+                        if(end + 1 < pending.size() && pending[end] == ':' && pending[end + 1] == '"')
+                        {
+                            open = i;
+                            break;
+                        }
+                    }
+                    i = pending.find('&', i + 1);
+                    continue;
+                }
+                //the command after a gradient's text stays with it (&@gradient:"3,..." takes its color),
+                //an escaped one doesn't end a gradient, the piece can't end there either
+                if(command.directive->prefix != '&' && i > 0 && pending[i - 1] != '\\' && !after_gradient) cut = i;
+                after_gradient = command.directive->kind == directives::Kind::GRADIENT;
+                has_gradient = has_gradient || after_gradient;
+                i = pending.find('&', i + command.length);
+            }
+            return cut;
+        }
+
+        //Somewhere near the end that isn't inside a command or a character, for text without any cut
+        size_t forcedCut(size_t open) const
+        {
+            size_t cut = open != std::string::npos ? open : pending.rfind('&');
+            if(cut == std::string::npos || (open == std::string::npos && cut < pending.size() / 2)) cut = pending.size();
+            while(cut > 0 && cut < pending.size() && (static_cast<unsigned char>(pending[cut]) & 0xC0) == 0x80) cut--;
+            return cut;
+        }
+
+        void emit(std::string_view written, bool styled_first)
+        {
+            if(components == 0)
+            {
+                if(!options.use_extra) out << (styled_first ? "[{\"text\":\"\"}," : "[") << written;
+                else if(styled_first) out << "{\"text\":\"\",\"extra\":[" << written;
+                else first.assign(written); //parent or lonely component, the next one tells
+            }
+            else if(holding_first())
+            {
+                out.write(first.data(), static_cast<std::streamsize>(first.size() - 1));
+                out << ",\"extra\":[" << written;
+                first.clear();
+            }
+            else
+            {
+                out << ',' << written;
+            }
+            components++;
+        }
+
+        bool holding_first() const
+        {
+            return !first.empty();
+        }
+
+        void convertPiece(size_t cut)
+        {
+            const std::string expanded = change_gradient(pending.substr(0, cut), options.gradient, options.delta_e);
+            pending.erase(0, cut);
+
+            detail::Components ir;
+            detail::parse_components(expanded, ir, &state);
+            for(const auto& c : ir.list)
+            {
+                component.clear();
+                if(c.page_break)
+                {
+                    emit("{\"text\":\"\\n{@pagebreak}\\n\"}", false);
+                    continue;
+                }
+                detail::write_component(component, ir.textOf(c), c.state);
+                emit(component, components == 0 && detail::has_extra_properties(c.state));
+            }
+        }
+
+    public:
+        /**
+         * @param max_pending Text without any place to cut bigger than this is cut anyway
+         * (outside gradients), it comes out as more than one component with the same look
+         */
+        explicit StreamConverter(std::ostream& out, const Options& options = {}, size_t max_pending = 1 << 20)
+            : out(out), options(options), max_pending(max_pending) {}
+
+        ~StreamConverter()
+        {
+            finish();
+        }
+
+        void write(std::string_view chunk)
+        {
+            pending += chunk;
+            bool has_gradient = false;
+            size_t open = std::string::npos;
+            size_t cut = findCut(has_gradient, open);
+            if(cut == 0 && pending.size() > max_pending && !has_gradient) cut = forcedCut(open);
+            if(cut > 0) convertPiece(cut);
+        }
+
+        //Converts what's left and closes the layout, nothing can be written after it
+        void finish()
+        {
+            if(finished) return;
+            finished = true;
+            if(!pending.empty()) convertPiece(pending.size());
+
+            if(components == 0) out << "\"\"";
+            else if(!options.use_extra) out << ']';
+            else if(holding_first()) out << '[' << first << ']'; //a lonely component is always an array
+            else out << "]}";
+            out.flush();
+        }
+
+        size_t componentCount() const
+        {
+            return components;
+        }
+
+        //Whole stream in, JSON out, chunk_size bytes held at a time (plus the piece being converted)
+        static void convert(std::istream& in, std::ostream& out, const Options& options = {}, size_t chunk_size = 64 << 10)
+        {
+            StreamConverter converter(out, options);
+            std::unique_ptr<char[]> buffer(new char[chunk_size]);
+            while(in)
+            {
+                in.read(buffer.get(), static_cast<std::streamsize>(chunk_size));
+                const std::streamsize got = in.gcount();
+                if(got <= 0) break;
+                converter.write(std::string_view(buffer.get(), static_cast<size_t>(got)));
+            }
+            converter.finish();
+        }
+    };
+}
+
+#endif
@@ -2,10 +2,21 @@
 #define CHAPTER_QUESTS_H
 
 #include <string>
+#include <string_view>
 #include <cstdint>
+#include <filesystem>
 #include <vector>
+#include <quests/id_map.h>
 #include <quests/quest.h>
+#include <quests/slot_map.h>
 
+class quest_store;
+
+/**
+ * @brief One file of chapters/, the quests themselves are in quest_store
+ * The chapter keeps the handles of its quests and finds them by id in O(1)
+ * Quests are added and removed through the store, it keeps both sides in sync
+ */
 class chapter
 {
 private:
@@ -17,21 +28,46 @@ private:
     std::string id;
     uint8_t order;
     std::vector<std::string> quest_links;
-    std::vector<quest> quests;
-    
+    std::vector<quest_handle> quests;
+    quests::id_map<size_t> quest_index; //quest id -> slot in quests
+
+    friend class quest_store;
+    bool addQuest(quest_handle q, const std::string& quest_id);
+    //all_quests resolves the handle moved into the hole, to update its index entry
+    bool removeQuest(std::string_view quest_id, const quests::slot_map<quest>& all_quests);
+
 public:
     chapter();
     ~chapter();
+    chapter(const chapter&) = default;
+    chapter(chapter&&) noexcept = default;
+    chapter& operator=(const chapter&) = default;
+    chapter& operator=(chapter&&) noexcept = default;
 
+    const std::string& getId() const;
     void changeFileName(std::string name);
     void setAutoFocus(std::string quest_id);
     void hideDependecyLines(bool hide);
     bool changeGroup(std::string group_id);
     void changeIcon(std::string icon_id);
-    bool addQuest(quest q);
-    bool removeQuest(quest target);
 
-    bool generateQuestFile();
+    //Handle of the quest of this chapter with that id, the default handle if there's none
+    quest_handle findQuest(std::string_view quest_id) const;
+    //Order isn't kept, a removed quest's slot is taken by the last one
+    const std::vector<quest_handle>& getQuests() const;
+    size_t questCount() const;
+
+    //chapters/<file name>.snbt, the file name falls back to the id
+    std::string fileName() const;
+    //Appends the whole file to out, quests included
+    void writeQuestText(std::string& out, const quest_store& store) const;
+    std::string generateQuestText(const quest_store& store) const;
+    //Takes the chapter's own fields from its file, the quests in it are added through the store
+    void read(const snbt::Compound& values);
+    //Writes root/chapters/<file name>.snbt alone, chapter_group::generateData writes the whole pack
+    bool generateQuestFile(const quest_store& store, const std::filesystem::path& root = "quests");
 };
 
+using chapter_handle = quests::handle<chapter>;
+
 #endif
\ No newline at end of file
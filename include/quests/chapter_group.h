@@ -1,9 +1,14 @@
 #ifndef CHAPTER_GROUP_QUESTS_H
 #define CHAPTER_GROUP_QUESTS_H
 
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
 #include <vector>
 #include <string>
+#include <utils/thread_pool.h>
 #include <quests/chapter.h>
+#include <quests/quest_store.h>
 #include <quests/reward.h>
 
 /**
@@ -20,19 +25,64 @@ class chapter_group
 private:
     //Tells the id of each chapter group, just for 1 file builder
     std::vector<std::string> chapters_group;
-    //How many chapter there are, each chapter is a file
-    std::vector<chapter> chapters;
-    std::vector<reward> reward_tables;
+    //Chapters (each chapter is a file), their quests and the reward tables
+    quest_store store;
+    //data.snbt as it was imported, written back as is
+    snbt::Compound data;
+
+    struct written_file
+    {
+        uint64_t hash = 0;
+        uint64_t size = 0;
+    };
+    //Content of every file as it was last written or imported, by path
+    std::unordered_map<std::string, written_file> manifest;
+    //chapter_groups.snbt and data.snbt, they only change on import
+    bool pack_dirty = true;
+    size_t last_serialized = 0;
+    size_t last_written = 0;
+    size_t last_removed = 0;
+
+    //The file already holds that content, going by the manifest (by the file itself if it isn't in there)
+    bool onDisk(const std::filesystem::path& path, const written_file& content) const;
 public:
     chapter_group();
     ~chapter_group();
 
-    std::vector<chapter> getChapters();
-    std::vector<std::string> getChapterGroup();
-    std::vector<reward> getRewardTables();
-    bool addRewardTable(reward table);
-    chapter* selectChapter(int index);
-    std::string generateData();
+    quest_store& getStore();
+    const quest_store& getStore() const;
+    const quests::slot_map<chapter>& getChapters() const;
+    const std::vector<std::string>& getChapterGroup() const;
+    const quests::slot_map<reward>& getRewardTables() const;
+    const snbt::Compound& getData() const;
+    reward_handle addRewardTable(reward&& table);
+    chapter* selectChapter(chapter_handle handle);
+    /**
+     * @brief Writes the pack under root: chapter_groups.snbt, chapters/<file name>.snbt and reward_tables/<id>.snbt
+     * Files are built and written on the pool at the same time, each one to a temp file renamed
+     * over the old one once all of them are on disk, a crash never leaves one half written
+     *
+     * Only dirty chapters and tables are serialized (the rest were written or imported as they are),
+     * and a file whose content hash is the one on disk isn't written again, so an unchanged pack touches nothing
+     * Chapter and table files written or imported before that the pack no longer has (removed, or the chapter's
+     * file name changed) are removed by the same commit
+     * @return empty if everything was written, the errors otherwise (one per line)
+     */
+    std::string generateData(const std::filesystem::path& root = "quests", utils::thread_pool& pool = utils::thread_pool::shared(),
+                             bool durable = true);
+    /**
+     * @brief Replaces the pack with the one under root (a config/ftbquests/quests folder)
+     * Every file is read and parsed on the pool, then the quests go in the store and their
+     * dependencies become edges in one pass over them
+     * Nothing changes if a file can't be read, an id is used twice or a dependency is missing or closes a loop
+     * @return empty if the pack was loaded, the errors otherwise (one per line)
+     */
+    std::string loadData(const std::filesystem::path& root = "quests", utils::thread_pool& pool = utils::thread_pool::shared());
+
+    //Files the last generateData serialized, the ones out of those it had to write, and the old ones it removed
+    size_t lastSerialized() const;
+    size_t lastWritten() const;
+    size_t lastRemoved() const;
 };
 
 namespace quests
@@ -40,7 +90,7 @@ namespace quests
     inline bool changeGroup(std::string id)
     {
         static chapter_group group;
-        for(auto i : group.getChapterGroup())
+        for(const auto& i : group.getChapterGroup())
         {
             if(i == id) return true;
         }
@@ -0,0 +1,25 @@
+#ifndef ID_MAP_QUESTS_H
+#define ID_MAP_QUESTS_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace quests
+{
+    //Hash of FTB ids that can be looked up with a string_view, no std::string made for a find
+    struct id_hash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view id) const
+        {
+            return std::hash<std::string_view>{}(id);
+        }
+    };
+
+    template<class T>
+    using id_map = std::unordered_map<std::string, T, id_hash, std::equal_to<>>;
+}
+
+#endif
@@ -6,9 +6,16 @@
 #include <vector>
 #include <string>
 #include <quests/reward.h>
+#include <quests/slot_map.h>
+#include <quests/snbt_reader.h>
+#include <quests/snbt_writer.h>
 
+class quest;
 struct connected_nodes;
 
+//Quests live in quest_store, this is how they're referenced
+using quest_handle = quests::handle<quest>;
+
 class quest
 {
 private:
@@ -18,11 +25,11 @@ public:
     std::string id; //quest id
     std::string icon; //icon of the quest
     snbt::List tags; //Tags for kubejs events (should only have snbt::String)
-    bool disable_completion_toast; //If the textbox from completing should appear
+    bool disable_completion_toast = false; //If the textbox from completing should appear
 
     //apprearance
-    Shapes shape;
-    float size; //8 max, min 0.10
+    Shapes shape = Shapes::DEFAULT;
+    float size = 0; //8 max, min 0.10 (0 = default)
     vec2 position = {0, 0};
     uint16_t min_opened_quest_window_width = 0; //0 to 3000
     float icon_scaling = 1; //0.10 min, 2 max
@@ -54,7 +61,7 @@ public:
 
     std::vector<snbt::Tag> tasks; //all the tasks you need to do, 1 entry per task
     std::vector<reward> rewards; //all the rewards you put
-    std::vector<connected_nodes> linked_nodes; //linked node aka dependency of other nodes, needed for dfs
+    std::vector<connected_nodes> linked_nodes; //quests that depend on this one, kept by quest_store::link
 
     //text
     std::string title; //ignore
@@ -64,17 +71,29 @@ public:
 
     quest() = default;
     ~quest() = default;
+    //the destructor would hide the moves, quests are moved around by quest_store
+    quest(const quest&) = default;
+    quest(quest&&) noexcept = default;
+    quest& operator=(const quest&) = default;
+    quest& operator=(quest&&) noexcept = default;
 
     bool operator==(quest const& obj) const
     {
         return this->id == obj.id;
     }
 
-    bool has_loop();
-    bool addConnection(connected_nodes n);
-    bool hasNode(quest n);
+    bool hasNode(quest_handle n) const;
 
-    std::string generateQuest();
+    /**
+     * @brief Appends the quest at the writer's level (chapter files write it inside quests: [...])
+     */
+    void write(quests::snbt_writer& w) const;
+    std::string generateQuest() const;
+    /**
+     * @brief Fills the quest from its compound of a chapter file, the other side of write()
+     * The ids of dependencies end up in needs_node_completed, quest_store::link turns them into edges
+     */
+    void read(const snbt::Compound& values);
 
     quest generateItemQuest();
     quest generateFluidQuest();
@@ -98,8 +117,8 @@ struct connected_nodes
     //value of the direction
     int value;
 
-    //Dst quest
-    quest* node_linked;
+    //Dst quest, a handle stays valid when the store moves quests around
+    quest_handle node_linked;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,111 @@
+#ifndef QUEST_GRAPH_QUESTS_H
+#define QUEST_GRAPH_QUESTS_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <quests/id_map.h>
+
+/**
+ * @brief Dependencies between quests, the edge A -> B means B needs A completed
+ * Quests are dense indices (given by id), edges are adjacency vectors both ways
+ *
+ * A topological order is kept all the time (Pearce-Kelly): an edge that already agrees with it
+ * is just pushed, otherwise only the quests between both ends of the order are visited and reordered.
+ * A loop is found during that same visit, no separate search is needed
+ *
+ * Worst case: the visit is bounded by the distance between both ends in the order, not by the size
+ * of the change, so an edge against the order can still walk (almost) the whole graph. Quests added
+ * in progression order keep that distance short; added in a random order most edges go against it,
+ * and the cost per edge gets close to a search of the graph (quest_graph_bench's shuffled run).
+ * Many edges at once (an import) go through addEdges, which sorts the whole graph once instead
+ */
+class quest_graph
+{
+public:
+    using node = uint32_t;
+    static constexpr node npos = UINT32_MAX;
+
+    enum class edge_result : uint8_t { ADDED, EXISTS, LOOP };
+
+private:
+    quests::id_map<node> index;
+    std::vector<std::string> ids;
+    std::vector<bool> live;
+    std::vector<node> free_nodes;
+
+    std::vector<std::vector<node>> out; //dependents
+    std::vector<std::vector<node>> in; //dependencies
+    size_t edges = 0;
+
+    std::vector<uint32_t> ord; //node -> position in the order
+    std::vector<node> at; //position -> node
+
+    //scratch of addEdge, kept to not allocate on every insertion
+    std::vector<uint32_t> mark;
+    uint32_t epoch = 0;
+    std::vector<node> stack, forward, backward;
+    std::vector<uint32_t> slots;
+
+    uint32_t nextEpoch();
+    bool visitForward(node from, node target, uint32_t upper);
+    void visitBackward(node from, uint32_t lower);
+    void reorder();
+    std::vector<uint32_t> components() const;
+    bool sortAll();
+
+public:
+    quest_graph() = default;
+    ~quest_graph() = default;
+    quest_graph(const quest_graph&) = default;
+    quest_graph(quest_graph&&) noexcept = default;
+    quest_graph& operator=(const quest_graph&) = default;
+    quest_graph& operator=(quest_graph&&) noexcept = default;
+
+    /**
+     * @brief Index of the quest with this id, added if it isn't in the graph yet
+     */
+    node addNode(const std::string& id);
+
+    /**
+     * @brief Removes the quest and every edge it has, its index can be given again
+     */
+    bool removeNode(node n);
+
+    node find(std::string_view id) const;
+    const std::string& idOf(node n) const;
+    bool contains(node n) const;
+
+    /**
+     * @brief Adds from -> to (to needs from)
+     * @return false if it would close a loop (or from == to), nothing changes then.
+     * An edge that already exists isn't added twice and returns true
+     */
+    bool addEdge(node from, node to);
+    /**
+     * @brief addEdge for many edges, each result is the one addEdge would give adding them in this order
+     * The edges are all linked first and the order is made again once (O(quests + edges)),
+     * only the ones on a loop of the whole batch go through addEdge one by one
+     */
+    std::vector<edge_result> addEdges(std::span<const std::pair<node, node>> list);
+    bool removeEdge(node from, node to);
+    bool hasEdge(node from, node to) const;
+
+    const std::vector<node>& dependents(node n) const;
+    const std::vector<node>& dependencies(node n) const;
+
+    //Position of the quest in the order, every dependency comes before its dependents
+    uint32_t position(node n) const;
+    //Live quests, dependencies first
+    std::vector<node> order() const;
+
+    size_t size() const;
+    size_t edgeCount() const;
+    void reserve(size_t nodes);
+    void clear();
+};
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef QUEST_STORE_QUESTS_H
+#define QUEST_STORE_QUESTS_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <quests/chapter.h>
+#include <quests/id_map.h>
+#include <quests/quest.h>
+#include <quests/quest_graph.h>
+#include <quests/reward.h>
+#include <quests/slot_map.h>
+
+/**
+ * @brief Owner of every quest, chapter and reward table of a pack
+ * Each one is in a generational slot map and is referenced by handle: handles don't dangle when
+ * things are added or removed (a handle to something removed just stops resolving) and checking one is O(1)
+ *
+ * Everything goes in by move and comes out by pointer or reference, nothing is copied.
+ * Dependencies go through quest_graph, link() refuses the ones that would close a loop
+ *
+ * Anything that can change a file marks it dirty: adds, removals, moves, links and the non-const getters.
+ * A dirty quest makes its chapter dirty, the export only serializes dirty chapters and tables.
+ * Removing a chapter or a table has no file left to mark, hasRemovals() tells the export some file has to go
+ */
+class quest_store
+{
+private:
+    quests::slot_map<quest> quests;
+    quests::slot_map<chapter> chapters;
+    quests::slot_map<reward> reward_tables;
+
+    quests::id_map<quest_handle> quest_ids;
+    quest_graph dependencies;
+
+    //by quest handle index, valid while the quest is alive
+    std::vector<chapter_handle> chapter_of;
+    std::vector<quest_graph::node> node_of;
+    //by graph node
+    std::vector<quest_handle> quest_at;
+
+    //by handle index, set when what the object writes may have changed
+    std::vector<uint8_t> quest_dirty;
+    std::vector<uint8_t> chapter_dirty;
+    std::vector<uint8_t> table_dirty;
+    bool removed = false; //a chapter or table was removed since the last clearDirty
+
+    void unlinkAll(quest_handle q);
+
+public:
+    quest_store() = default;
+    ~quest_store() = default;
+    quest_store(quest_store&&) noexcept = default;
+    quest_store& operator=(quest_store&&) noexcept = default;
+
+    chapter_handle addChapter(chapter&& c);
+    //Removes the chapter and every quest in it
+    bool removeChapter(chapter_handle c);
+
+    /**
+     * @brief Moves the quest into the chapter
+     * @return the default handle if the chapter isn't there or the id is already used (q is left as it was)
+     * The id is the key of the quest, it isn't changed while the quest is in the store
+     */
+    quest_handle addQuest(chapter_handle c, quest&& q);
+    //Removes the quest, its dependencies and its place in the chapter
+    bool removeQuest(quest_handle q);
+    bool moveQuest(quest_handle q, chapter_handle to);
+
+    reward_handle addRewardTable(reward&& r);
+    bool removeRewardTable(reward_handle r);
+
+    /**
+     * @brief to needs from completed (from.linked_nodes gets to, to.needs_node_completed gets from's id)
+     * @return false if a handle doesn't resolve or the dependency would close a loop
+     */
+    bool link(quest_handle from, quest_handle to, int value = 0);
+    /**
+     * @brief link() with value 0 for every pair, each result is the one link() would give in this order
+     * Checks the loops of all of them at once, an import of a whole pack goes through here
+     */
+    std::vector<bool> linkAll(std::span<const std::pair<quest_handle, quest_handle>> links);
+    bool unlink(quest_handle from, quest_handle to);
+
+    //The non-const getters mark what they return as dirty, use a const store to only read
+    quest* getQuest(quest_handle q);
+    const quest* getQuest(quest_handle q) const;
+    chapter* getChapter(chapter_handle c);
+    const chapter* getChapter(chapter_handle c) const;
+    reward* getRewardTable(reward_handle r);
+    const reward* getRewardTable(reward_handle r) const;
+
+    void markDirty(quest_handle q);
+    void markDirty(chapter_handle c);
+    void markDirty(reward_handle r);
+    bool isDirty(quest_handle q) const;
+    bool isDirty(chapter_handle c) const;
+    bool isDirty(reward_handle r) const;
+    bool hasRemovals() const;
+    //Once everything is written
+    void clearDirty();
+
+    quest_handle findQuest(std::string_view quest_id) const;
+    chapter_handle chapterOf(quest_handle q) const;
+
+    const quests::slot_map<quest>& allQuests() const;
+    const quests::slot_map<chapter>& allChapters() const;
+    const quests::slot_map<reward>& allRewardTables() const;
+    const quest_graph& graph() const;
+
+    void reserve(size_t quest_count, size_t chapter_count);
+};
+
+#endif
@@ -6,6 +6,9 @@
 #include <string>
 #include <stdlib.h>
 #include <parser/parser.h>
+#include <quests/slot_map.h>
+#include <quests/snbt_reader.h>
+#include <quests/snbt_writer.h>
 
 /**
  * @brief Represent a reward from a quest
@@ -41,14 +44,25 @@ public:
 
     reward() = default;
     ~reward() = default;
+    reward(const reward&) = default;
+    reward(reward&&) noexcept = default;
+    reward& operator=(const reward&) = default;
+    reward& operator=(reward&&) noexcept = default;
 
 
     /**
-     * @brief Generate a string representation of the quests (basically snbt::to_string)
+     * @brief Appends the reward at the writer's level (inside a quest's rewards: [...])
+     */
+    void write(quests::snbt_writer& w) const;
+
+    /**
+     * @brief Generate a string representation of the reward (what a reward table file holds)
      * 
      * @return std::string 
      */
-    std::string generateReward();
+    std::string generateReward() const;
+    //Fills the reward from a compound (in a quest's rewards or a reward table file)
+    void read(const snbt::Compound& values);
 
     reward generateItemReward();
     reward generateChoiseReward();
@@ -63,4 +77,6 @@ public:
     reward generateStageReward();
 };
 
+using reward_handle = quests::handle<reward>;
+
 #endif
\ No newline at end of file
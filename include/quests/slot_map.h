@@ -0,0 +1,163 @@
+#ifndef SLOT_MAP_QUESTS_H
+#define SLOT_MAP_QUESTS_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace quests
+{
+    /**
+     * @brief Reference to a value of a slot_map, stays valid while the value is there
+     * Once it's erased every handle to it stops resolving, even if the slot holds something new
+     * (the generation doesn't match). The default one never resolves
+     */
+    template<class T>
+    struct handle
+    {
+        uint32_t index = UINT32_MAX;
+        uint32_t generation = 0;
+
+        explicit operator bool() const
+        {
+            return index != UINT32_MAX;
+        }
+
+        bool operator==(const handle&) const = default;
+    };
+
+    /**
+     * @brief Generational slot map: values are packed in one vector, handles go through a slot
+     * Insert, erase and lookups are O(1), erase moves the last value into the hole
+     * Iterating goes over the packed values (their order changes when something is erased)
+     */
+    template<class T>
+    class slot_map
+    {
+    public:
+        using handle_type = handle<T>;
+
+    private:
+        static constexpr uint32_t FREE = UINT32_MAX;
+
+        struct slot
+        {
+            uint32_t dense = FREE; //position in values
+            uint32_t generation = 0;
+        };
+
+        std::vector<slot> slots;
+        std::vector<uint32_t> free_slots;
+        std::vector<T> values;
+        std::vector<uint32_t> owners; //position in values -> slot
+
+    public:
+        template<class... Args>
+        handle_type emplace(Args&&... args)
+        {
+            uint32_t index;
+            if(!free_slots.empty())
+            {
+                index = free_slots.back();
+                free_slots.pop_back();
+            }
+            else
+            {
+                index = static_cast<uint32_t>(slots.size());
+                slots.emplace_back();
+            }
+            values.emplace_back(std::forward<Args>(args)...);
+            owners.push_back(index);
+            slots[index].dense = static_cast<uint32_t>(values.size() - 1);
+            return {index, slots[index].generation};
+        }
+
+        handle_type insert(T&& value)
+        {
+            return emplace(std::move(value));
+        }
+
+        bool erase(handle_type h)
+        {
+            if(!contains(h)) return false;
+            const uint32_t dense = slots[h.index].dense;
+            if(dense + 1 != values.size())
+            {
+                values[dense] = std::move(values.back());
+                owners[dense] = owners.back();
+                slots[owners[dense]].dense = dense;
+            }
+            values.pop_back();
+            owners.pop_back();
+
+            slots[h.index].dense = FREE;
+            slots[h.index].generation++;
+            free_slots.push_back(h.index);
+            return true;
+        }
+
+        bool contains(handle_type h) const
+        {
+            return h.index < slots.size() && slots[h.index].generation == h.generation && slots[h.index].dense != FREE;
+        }
+
+        T* get(handle_type h)
+        {
+            return contains(h) ? &values[slots[h.index].dense] : nullptr;
+        }
+
+        const T* get(handle_type h) const
+        {
+            return contains(h) ? &values[slots[h.index].dense] : nullptr;
+        }
+
+        //Handle of the value at position i of the iteration
+        handle_type handleAt(size_t i) const
+        {
+            return {owners[i], slots[owners[i]].generation};
+        }
+
+        size_t size() const
+        {
+            return values.size();
+        }
+
+        bool empty() const
+        {
+            return values.empty();
+        }
+
+        //Slots ever used, handle indices are below it
+        size_t capacity() const
+        {
+            return slots.size();
+        }
+
+        void reserve(size_t count)
+        {
+            slots.reserve(count);
+            values.reserve(count);
+            owners.reserve(count);
+        }
+
+        //Every handle given so far stops resolving
+        void clear()
+        {
+            for(uint32_t owner : owners)
+            {
+                slots[owner].dense = FREE;
+                slots[owner].generation++;
+                free_slots.push_back(owner);
+            }
+            values.clear();
+            owners.clear();
+        }
+
+        auto begin() { return values.begin(); }
+        auto end() { return values.end(); }
+        auto begin() const { return values.begin(); }
+        auto end() const { return values.end(); }
+    };
+}
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef SNBT_READER_QUESTS_H
+#define SNBT_READER_QUESTS_H
+
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <files/basic_header.h>
+#include <parser/parser.h>
+#include <utils/escape.h>
+
+namespace quests
+{
+    /**
+     * @brief Undoes the escapes of every string in the tree (snbt::Parser keeps strings as they're written)
+     * Only strings with a backslash are touched, so a parsed file is walked once and mostly left as is
+     * Throws std::runtime_error when two keys of a compound are the same once unescaped
+     */
+    inline void unescapeStrings(snbt::Tag& value)
+    {
+        using Type = snbt::Tag::Type;
+        switch(value.type())
+        {
+            case Type::String:
+            {
+                const std::string& text = value.as<snbt::String>();
+                if(text.find('\\') == std::string::npos) return;
+                std::string plain;
+                plain.reserve(text.size());
+                utils::append_unescaped(plain, text);
+                value = snbt::Tag(std::move(plain));
+                return;
+            }
+            case Type::List:
+                for(snbt::Tag& item : value.as<snbt::List>()) unescapeStrings(item);
+                return;
+            case Type::Compound:
+            {
+                auto& values = value.as<snbt::Compound>();
+                //quoted keys with escapes are rare, their entries are taken out while walking
+                //and go in again under the plain key once every value has been done (once)
+                std::vector<snbt::Compound::node_type> escaped;
+                for(auto it = values.begin(); it != values.end();)
+                {
+                    unescapeStrings(it->second);
+                    auto next = std::next(it);
+                    if(it->first.find('\\') != std::string::npos) escaped.push_back(values.extract(it));
+                    it = next;
+                }
+                for(auto& entry : escaped)
+                {
+                    std::string plain;
+                    utils::append_unescaped(plain, entry.key());
+                    entry.key() = std::move(plain);
+                    auto inserted = values.insert(std::move(entry));
+                    if(!inserted.inserted) throw std::runtime_error("key \"" + inserted.node.key() + "\" is there twice");
+                }
+                return;
+            }
+            default:
+                return;
+        }
+    }
+
+    /**
+     * @brief Reads the fields of one FTB Quests compound, the other side of snbt_writer
+     * Every getter leaves its output alone when the key isn't there or has another type,
+     * so fields keep their defaults (what the writer skips) unless the file says otherwise
+     */
+    class snbt_reader
+    {
+    private:
+        const snbt::Compound& values;
+
+        static bool numeric(const snbt::Tag& value, double& out)
+        {
+            using Type = snbt::Tag::Type;
+            switch(value.type())
+            {
+                case Type::Byte: out = value.as<snbt::Byte>(); return true;
+                case Type::Short: out = value.as<snbt::Short>(); return true;
+                case Type::Int: out = value.as<snbt::Int>(); return true;
+                case Type::Long: out = static_cast<double>(value.as<snbt::Long>()); return true;
+                case Type::Float: out = value.as<snbt::Float>(); return true;
+                case Type::Double: out = value.as<snbt::Double>(); return true;
+                default: return false;
+            }
+        }
+
+    public:
+        explicit snbt_reader(const snbt::Compound& values) : values(values) {}
+
+        const snbt::Tag* find(std::string_view key) const
+        {
+            auto it = values.find(std::string(key));
+            return it != values.end() ? &it->second : nullptr;
+        }
+
+        const snbt::Compound* object(std::string_view key) const
+        {
+            const snbt::Tag* value = find(key);
+            return value && value->type() == snbt::Tag::Type::Compound ? &value->as<snbt::Compound>() : nullptr;
+        }
+
+        const snbt::List* list(std::string_view key) const
+        {
+            const snbt::Tag* value = find(key);
+            return value && value->type() == snbt::Tag::Type::List ? &value->as<snbt::List>() : nullptr;
+        }
+
+        bool string(std::string_view key, std::string& out) const
+        {
+            const snbt::Tag* value = find(key);
+            if(!value || value->type() != snbt::Tag::Type::String) return false;
+            out = value->as<snbt::String>();
+            return true;
+        }
+
+        //true/false, or 1b/0b like vanilla NBT writes them
+        bool boolean(std::string_view key, bool& out) const
+        {
+            const snbt::Tag* value = find(key);
+            if(!value) return false;
+            if(value->type() == snbt::Tag::Type::Boolean) out = value->as<snbt::Boolean>();
+            else if(value->type() == snbt::Tag::Type::Byte) out = value->as<snbt::Byte>() != 0;
+            else return false;
+            return true;
+        }
+
+        //FTB's tristates: a missing key is DEFAULT, true is HIDDEN and false is VISIBLE
+        bool tristate(std::string_view key, Hide& out) const
+        {
+            bool value;
+            if(!boolean(key, value)) return false;
+            out = value ? Hide::HIDDEN : Hide::VISIBLE;
+            return true;
+        }
+
+        //Any number type, integers are rounded
+        template<class T>
+        bool number(std::string_view key, T& out) const
+        {
+            const snbt::Tag* value = find(key);
+            double read;
+            if(!value || !numeric(*value, read)) return false;
+            if constexpr(std::is_integral_v<T>) out = static_cast<T>(std::llround(read));
+            else out = static_cast<T>(read);
+            return true;
+        }
+
+        bool stringList(std::string_view key, std::vector<std::string>& out) const
+        {
+            const snbt::List* items = list(key);
+            if(!items) return false;
+            out.clear();
+            out.reserve(items->size());
+            for(const snbt::Tag& item : *items)
+            {
+                if(item.type() == snbt::Tag::Type::String) out.push_back(item.as<snbt::String>());
+            }
+            return true;
+        }
+
+        //Items are written both ways: icon: "modid:item" or icon: { id: "modid:item", ... }
+        bool itemId(std::string_view key, std::string& out) const
+        {
+            if(string(key, out)) return true;
+            const snbt::Compound* nested = object(key);
+            return nested && snbt_reader(*nested).string("id", out);
+        }
+
+        //Enum written by name, N names indexed by the enum's value
+        template<class E, size_t N>
+        bool name(std::string_view key, const std::string_view (&names)[N], E& out) const
+        {
+            const snbt::Tag* value = find(key);
+            if(!value || value->type() != snbt::Tag::Type::String) return false;
+            const std::string& text = value->as<snbt::String>();
+            for(size_t i = 0; i < N; i++)
+            {
+                if(names[i] == text)
+                {
+                    out = static_cast<E>(i);
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef SNBT_WRITER_QUESTS_H
+#define SNBT_WRITER_QUESTS_H
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <parser/parser.h>
+#include <utils/escape.h>
+
+namespace quests
+{
+    /**
+     * @brief Writes FTB Quests SNBT (one "key: value" per line, 4 spaces per level) straight into a buffer
+     * Quests, tasks and rewards append to the chapter's buffer at their level, nothing is
+     * built as a separate string and indented again. The indentation is a slice of a constant
+     */
+    class snbt_writer
+    {
+    private:
+        static constexpr std::string_view INDENT = "                                                                ";
+        static constexpr size_t INDENT_WIDTH = 4;
+
+        std::string& out;
+        size_t depth;
+
+        void indent()
+        {
+            size_t spaces = depth * INDENT_WIDTH;
+            while(spaces > INDENT.size())
+            {
+                out += INDENT;
+                spaces -= INDENT.size();
+            }
+            out.append(INDENT.data(), spaces);
+        }
+
+        //Key of an entry, nothing for the items of a list
+        void open(std::string_view key)
+        {
+            indent();
+            if(key.empty()) return;
+            if(simpleKey(key)) out += key;
+            else quoted(key);
+            out += ": ";
+        }
+
+        void quoted(std::string_view text)
+        {
+            out += '"';
+            utils::append_escaped(out, text, utils::EscapeStyle::SNBT);
+            out += '"';
+        }
+
+        template<class F>
+        void number(F value)
+        {
+            char buffer[32];
+            const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            const std::string_view digits(buffer, static_cast<size_t>(end - buffer));
+            out += digits;
+            if(digits.find_first_of(".en") == std::string_view::npos) out += ".0";
+        }
+
+        template<class T>
+        void integer(T value)
+        {
+            char buffer[24];
+            const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, static_cast<size_t>(end - buffer));
+        }
+
+    public:
+        explicit snbt_writer(std::string& out, size_t depth = 0) : out(out), depth(depth) {}
+
+        static constexpr bool simpleKey(std::string_view key)
+        {
+            for(char c : key)
+            {
+                const bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                                c == '_' || c == '-' || c == '.' || c == '+';
+                if(!ok) return false;
+            }
+            return !key.empty();
+        }
+
+        void beginObject(std::string_view key = {})
+        {
+            open(key);
+            out += "{\n";
+            depth++;
+        }
+
+        void endObject()
+        {
+            depth--;
+            indent();
+            out += "}\n";
+        }
+
+        void beginList(std::string_view key = {})
+        {
+            open(key);
+            out += "[\n";
+            depth++;
+        }
+
+        void endList()
+        {
+            depth--;
+            indent();
+            out += "]\n";
+        }
+
+        void string(std::string_view key, std::string_view value)
+        {
+            open(key);
+            quoted(value);
+            out += '\n';
+        }
+
+        void boolean(std::string_view key, bool value)
+        {
+            open(key);
+            out += value ? "true\n" : "false\n";
+        }
+
+        void integer(std::string_view key, int64_t value)
+        {
+            open(key);
+            integer(value);
+            out += '\n';
+        }
+
+        void real(std::string_view key, double value)
+        {
+            open(key);
+            number(value);
+            out += "d\n";
+        }
+
+        void stringList(std::string_view key, const std::vector<std::string>& values)
+        {
+            beginList(key);
+            for(const auto& value : values) string({}, value);
+            endList();
+        }
+
+        //Any tag (tasks are kept as tags), compounds and lists one entry per line like the rest
+        void tag(std::string_view key, const snbt::Tag& value)
+        {
+            using Type = snbt::Tag::Type;
+            switch(value.type())
+            {
+                case Type::Compound:
+                    beginObject(key);
+                    for(const auto& [name, item] : value.as<snbt::Compound>()) tag(name, item);
+                    endObject();
+                    return;
+                case Type::List:
+                    beginList(key);
+                    for(const auto& item : value.as<snbt::List>()) tag({}, item);
+                    endList();
+                    return;
+                default:
+                    break;
+            }
+
+            open(key);
+            switch(value.type())
+            {
+                case Type::Byte: integer(value.as<snbt::Byte>()); out += 'b'; break;
+                case Type::Short: integer(value.as<snbt::Short>()); out += 's'; break;
+                case Type::Int: integer(value.as<snbt::Int>()); break;
+                case Type::Long: integer(value.as<snbt::Long>()); out += 'L'; break;
+                case Type::Boolean: out += value.as<snbt::Boolean>() ? "true" : "false"; break;
+                case Type::Float: number(value.as<snbt::Float>()); out += 'f'; break;
+                case Type::Double: number(value.as<snbt::Double>()); out += 'd'; break;
+                case Type::String: quoted(value.as<snbt::String>()); break;
+                default: out += snbt::to_string(value); break; //arrays, already one line
+            }
+            out += '\n';
+        }
+    };
+}
+
+#endif
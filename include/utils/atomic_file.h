@@ -0,0 +1,234 @@
+#ifndef UTILS_ATOMIC_FILE_H
+#define UTILS_ATOMIC_FILE_H
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include <utils/thread_pool.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace utils
+{
+    /**
+     * @brief Writes a set of files so none of them is ever seen half written
+     * stage() writes each file to a temp next to it (callable from many threads at once),
+     * commit() flushes them all to disk in one batch, renames them over their targets
+     * and flushes each directory once. A reader sees the old file or the new one, nothing in between
+     *
+     * Temps end in .tmp so a game reading *.snbt never picks them up. Nothing is renamed
+     * if a stage failed, abort() (or the destructor) removes the temps left
+     * Files that have to go (stageRemoval) are removed by the same commit, once every new file is in place
+     */
+    class atomic_writer
+    {
+    private:
+        struct staged
+        {
+            std::filesystem::path target;
+            std::filesystem::path temp;
+        };
+
+        bool durable;
+        std::vector<staged> files;
+        std::vector<std::filesystem::path> removals;
+        std::vector<std::string> failures;
+        std::mutex mutex;
+
+        static std::filesystem::path tempFor(const std::filesystem::path& target)
+        {
+            static std::atomic<unsigned> counter{0};
+            std::filesystem::path temp = target;
+            std::string suffix = ".";
+            suffix.append(std::to_string(counter.fetch_add(1))).append(".tmp");
+            temp += suffix;
+            return temp;
+        }
+
+        //Data of the file on the disk, not only in the OS cache
+        static bool syncFile(const std::filesystem::path& path)
+        {
+#ifdef _WIN32
+            const int fd = _wopen(path.c_str(), _O_RDWR | _O_BINARY);
+            if(fd < 0) return false;
+            const bool ok = _commit(fd) == 0;
+            _close(fd);
+            return ok;
+#else
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if(fd < 0) return false;
+            const bool ok = ::fsync(fd) == 0;
+            ::close(fd);
+            return ok;
+#endif
+        }
+
+        //The renames themselves, Windows has no equivalent (MoveFileEx is already durable enough)
+        static void syncDirectory([[maybe_unused]] const std::filesystem::path& directory)
+        {
+#ifndef _WIN32
+            const int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_CLOEXEC);
+            if(fd < 0) return;
+            ::fsync(fd);
+            ::close(fd);
+#endif
+        }
+
+        void fail(std::string message)
+        {
+            std::lock_guard lock(mutex);
+            failures.push_back(std::move(message));
+        }
+
+    public:
+        /**
+         * @param durable false skips the flushes to disk: still never half written for readers,
+         * but a power cut right after can lose the new content
+         */
+        explicit atomic_writer(bool durable = true) : durable(durable) {}
+
+        ~atomic_writer()
+        {
+            abort();
+        }
+
+        atomic_writer(const atomic_writer&) = delete;
+        atomic_writer& operator=(const atomic_writer&) = delete;
+
+        /**
+         * @brief Writes data to a temp file for path, the directories are created if needed
+         * @return false if it couldn't be written, the reason is in errors()
+         */
+        bool stage(const std::filesystem::path& path, std::string_view data)
+        {
+            std::error_code ec;
+            if(path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), ec);
+
+            const std::filesystem::path temp = tempFor(path);
+            {
+                std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+                file.write(data.data(), static_cast<std::streamsize>(data.size()));
+                file.close();
+                if(!file)
+                {
+                    std::filesystem::remove(temp, ec);
+                    fail("Couldn't write " + path.string());
+                    return false;
+                }
+            }
+
+            std::lock_guard lock(mutex);
+            files.push_back({path, temp});
+            return true;
+        }
+
+        //path is removed by commit() after the renames, it's left alone if anything failed before
+        void stageRemoval(const std::filesystem::path& path)
+        {
+            std::lock_guard lock(mutex);
+            removals.push_back(path);
+        }
+
+        /**
+         * @brief Flushes every temp (in parallel on pool), then renames them over their targets
+         * @return false if something failed, see errors(). Files renamed before the failure stay new
+         */
+        bool commit(thread_pool& pool = thread_pool::shared())
+        {
+            if(!failures.empty())
+            {
+                abort();
+                return false;
+            }
+
+            if(durable)
+            {
+                std::vector<char> synced(files.size(), 1);
+                pool.parallel_for(files.size(), 4, [&](size_t begin, size_t end) {
+                    for(size_t i = begin; i < end; i++) synced[i] = syncFile(files[i].temp);
+                });
+                for(size_t i = 0; i < files.size(); i++)
+                {
+                    if(!synced[i]) failures.push_back("Couldn't flush " + files[i].target.string());
+                }
+                if(!failures.empty())
+                {
+                    abort();
+                    return false;
+                }
+            }
+
+            std::set<std::filesystem::path> directories;
+            for(const staged& file : files)
+            {
+                std::error_code ec;
+                std::filesystem::rename(file.temp, file.target, ec);
+                if(ec)
+                {
+                    failures.push_back("Couldn't replace " + file.target.string() + ": " + ec.message());
+                    std::filesystem::remove(file.temp, ec);
+                    continue;
+                }
+                directories.insert(file.target.parent_path());
+            }
+            files.clear();
+
+            //a failed rename keeps the old files, so the ones they replace stay too
+            if(failures.empty())
+            {
+                for(const auto& path : removals)
+                {
+                    std::error_code ec;
+                    std::filesystem::remove(path, ec);
+                    if(ec) failures.push_back("Couldn't remove " + path.string() + ": " + ec.message());
+                    else directories.insert(path.parent_path());
+                }
+            }
+            removals.clear();
+
+            if(durable)
+            {
+                for(const auto& directory : directories) syncDirectory(directory);
+            }
+            return failures.empty();
+        }
+
+        //Removes the temps not renamed yet, the targets are left as they were
+        void abort()
+        {
+            std::error_code ec;
+            for(const staged& file : files) std::filesystem::remove(file.temp, ec);
+            files.clear();
+            removals.clear();
+        }
+
+        size_t pending() const
+        {
+            return files.size();
+        }
+
+        size_t pendingRemovals() const
+        {
+            return removals.size();
+        }
+
+        const std::vector<std::string>& errors() const
+        {
+            return failures;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef UTILS_ESCAPE_H
+#define UTILS_ESCAPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utils/utf8.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define UTILS_ESCAPE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    #include <arm_neon.h>
+    #define UTILS_ESCAPE_NEON 1
+#endif
+
+namespace utils
+{
+    /**
+     * @brief How the escaped string is written
+     * JSON: \u00xx lowercase, DEL stays as it is (raw text components)
+     * SNBT: \u00XX uppercase and DEL escaped too (what the SNBT writer always did)
+     */
+    enum class EscapeStyle : uint8_t { JSON, SNBT };
+
+    namespace detail
+    {
+        //0 = copy as is, anything else is the letter after the backslash ('u' for \u00XX)
+        struct EscapeTable
+        {
+            char value[256] = {};
+
+            constexpr EscapeTable(bool escape_delete)
+            {
+                for(int c = 0; c < 0x20; c++) value[c] = 'u';
+                value[static_cast<unsigned char>('"')] = '"';
+                value[static_cast<unsigned char>('\\')] = '\\';
+                value[static_cast<unsigned char>('\b')] = 'b';
+                value[static_cast<unsigned char>('\f')] = 'f';
+                value[static_cast<unsigned char>('\n')] = 'n';
+                value[static_cast<unsigned char>('\r')] = 'r';
+                value[static_cast<unsigned char>('\t')] = 't';
+                if(escape_delete) value[0x7F] = 'u';
+            }
+        };
+
+        inline constexpr EscapeTable JSON_ESCAPES(false);
+        inline constexpr EscapeTable SNBT_ESCAPES(true);
+
+        //Bytes before the first one that needs escaping (size if none does)
+        inline size_t clean_prefix(const char* data, size_t size, EscapeStyle style)
+        {
+            const char* table = style == EscapeStyle::SNBT ? SNBT_ESCAPES.value : JSON_ESCAPES.value;
+            size_t i = 0;
+
+#if defined(UTILS_ESCAPE_SSE2)
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i control = _mm_set1_epi8(0x1F);
+            const __m128i del = _mm_set1_epi8(style == EscapeStyle::SNBT ? 0x7F : '"');
+            for(; i + 16 <= size; i += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                //unsigned v <= 0x1F is min(v, 0x1F) == v
+                __m128i hit = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                    _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(v, control), v), _mm_cmpeq_epi8(v, del)));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+                if(mask) return i + static_cast<size_t>(__builtin_ctz(mask));
+            }
+#elif defined(UTILS_ESCAPE_NEON)
+            const uint8x16_t quote = vdupq_n_u8('"');
+            const uint8x16_t backslash = vdupq_n_u8('\\');
+            const uint8x16_t control = vdupq_n_u8(0x20);
+            const uint8x16_t del = vdupq_n_u8(style == EscapeStyle::SNBT ? 0x7F : '"');
+            for(; i + 16 <= size; i += 16)
+            {
+                uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+                uint8x16_t hit = vorrq_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)),
+                                          vorrq_u8(vcltq_u8(v, control), vceqq_u8(v, del)));
+                if(vmaxvq_u8(hit)) break; //the tail loop finds which one
+            }
+#endif
+            for(; i < size; i++)
+            {
+                if(table[static_cast<unsigned char>(data[i])]) return i;
+            }
+            return size;
+        }
+    }
+
+    //Worst case size of an escaped string (every byte as \u00XX)
+    inline constexpr size_t escape_bound(size_t size)
+    {
+        return size * 6;
+    }
+
+    /**
+     * @brief Escapes src into dst (no quotes around it), clean runs are copied in bulk
+     * dst must have room for escape_bound(src.size()) bytes
+     * @return Bytes written
+     */
+    inline size_t escape_to(char* dst, std::string_view src, EscapeStyle style = EscapeStyle::JSON)
+    {
+        const char* table = style == EscapeStyle::SNBT ? detail::SNBT_ESCAPES.value : detail::JSON_ESCAPES.value;
+        const char* digits = style == EscapeStyle::SNBT ? "0123456789ABCDEF" : "0123456789abcdef";
+        const char* data = src.data();
+        const size_t size = src.size();
+        char* out = dst;
+        size_t i = 0;
+
+        while(i < size)
+        {
+            size_t clean = detail::clean_prefix(data + i, size - i, style);
+            std::memcpy(out, data + i, clean);
+            out += clean;
+            i += clean;
+            if(i == size) break;
+
+            unsigned char c = static_cast<unsigned char>(data[i++]);
+            char kind = table[c];
+            *out++ = '\\';
+            if(kind == 'u')
+            {
+                std::memcpy(out, "u00", 3);
+                out[3] = digits[c >> 4];
+                out[4] = digits[c & 0xF];
+                out += 5;
+            }
+            else
+            {
+                *out++ = kind;
+            }
+        }
+        return static_cast<size_t>(out - dst);
+    }
+
+    //Appends src escaped to out
+    inline void append_escaped(std::string& out, std::string_view src, EscapeStyle style = EscapeStyle::JSON)
+    {
+        //most text needs nothing, so grow for the worst case without zeroing it
+        //big inputs go in pieces so the worst case stays small
+        constexpr size_t PIECE = 16 * 1024;
+        while(!src.empty())
+        {
+            const std::string_view piece = src.substr(0, PIECE);
+            const size_t old_size = out.size();
+            out.resize_and_overwrite(old_size + escape_bound(piece.size()), [&](char* buffer, size_t) {
+                return old_size + escape_to(buffer + old_size, piece, style);
+            });
+            src.remove_prefix(piece.size());
+        }
+    }
+
+    inline constexpr int hex_digit(char c)
+    {
+        if(c >= '0' && c <= '9') return c - '0';
+        if(c >= 'a' && c <= 'f') return 10 + (c - 'a');
+        if(c >= 'A' && c <= 'F') return 10 + (c - 'A');
+        return -1;
+    }
+
+    //Value of the 4 hex digits text starts with (a \uXXXX escape), -1 if they aren't
+    inline int32_t read_hex4(std::string_view text)
+    {
+        if(text.size() < 4) return -1;
+        int32_t value = 0;
+        for(size_t i = 0; i < 4; i++)
+        {
+            const int digit = hex_digit(text[i]);
+            if(digit < 0) return -1;
+            value = value * 16 + digit;
+        }
+        return value;
+    }
+
+    /**
+     * @brief Appends src with its escapes undone, the reverse of append_escaped for both styles
+     * An unknown escape (\' in SNBT) keeps the character after the backslash
+     */
+    inline void append_unescaped(std::string& out, std::string_view src)
+    {
+        while(!src.empty())
+        {
+            const size_t clean = src.find('\\');
+            out.append(src.substr(0, clean));
+            if(clean == std::string_view::npos) return;
+            if(clean + 1 == src.size())
+            {
+                out += '\\';
+                return;
+            }
+
+            const char e = src[clean + 1];
+            src.remove_prefix(clean + 2);
+            switch(e)
+            {
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u':
+                {
+                    int32_t cp = read_hex4(src);
+                    if(cp < 0)
+                    {
+                        out += 'u';
+                        break;
+                    }
+                    src.remove_prefix(4);
+                    //a surrogate pair is one code point
+                    if(cp >= 0xD800 && cp <= 0xDBFF && src.size() >= 6 && src[0] == '\\' && src[1] == 'u')
+                    {
+                        const int32_t low = read_hex4(src.substr(2));
+                        if(low >= 0xDC00 && low <= 0xDFFF)
+                        {
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                            src.remove_prefix(6);
+                        }
+                    }
+                    utf8::append(out, static_cast<uint32_t>(cp));
+                    break;
+                }
+                default: out += e; break;
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef UTILS_HASH_H
+#define UTILS_HASH_H
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace utils
+{
+    //Final mix of murmur3, spreads every input bit over the whole result
+    inline constexpr uint64_t mix64(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    inline constexpr uint64_t combine(uint64_t seed, uint64_t value)
+    {
+        return mix64(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+    }
+
+    /**
+     * @brief Fast 64 bit hash, 8 bytes per step
+     * Not cryptographic, good enough for cache keys and deduplication
+     */
+    inline uint64_t hash64(std::string_view data, uint64_t seed = 0)
+    {
+        constexpr uint64_t prime = 0x9e3779b97f4a7c15ULL;
+        uint64_t h = seed ^ (data.size() * prime);
+        const char* p = data.data();
+        size_t left = data.size();
+
+        while(left >= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            h = (h ^ mix64(word)) * prime;
+            h ^= h >> 29;
+            p += 8;
+            left -= 8;
+        }
+
+        uint64_t tail = 0;
+        std::memcpy(&tail, p, left);
+        h = (h ^ mix64(tail ^ left)) * prime;
+        return mix64(h);
+    }
+}
+
+#endif
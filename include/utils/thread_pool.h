@@ -0,0 +1,143 @@
+#ifndef UTILS_THREAD_POOL_H
+#define UTILS_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils
+{
+    /**
+     * @brief Fixed set of worker threads for the batch jobs (conversion, export, import...)
+     * Work is handed out with parallel_for, the calling thread also works
+     * so a pool of 1 thread just runs everything inline
+     */
+    class thread_pool
+    {
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+
+        void worker_loop()
+        {
+            while(true)
+            {
+                std::function<void()> job;
+                {
+                    std::unique_lock lock(mutex);
+                    wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                    if(jobs.empty()) return;
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+                job();
+            }
+        }
+
+    public:
+        /**
+         * @param threads Total threads doing work, including the caller of parallel_for
+         */
+        explicit thread_pool(unsigned threads = std::max(1u, std::thread::hardware_concurrency()))
+        {
+            for(unsigned i = 1; i < threads; i++)
+            {
+                workers.emplace_back([this]() { worker_loop(); });
+            }
+        }
+
+        ~thread_pool()
+        {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for(auto& worker : workers) worker.join();
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        unsigned size() const
+        {
+            return static_cast<unsigned>(workers.size()) + 1;
+        }
+
+        /**
+         * @brief Calls fn(begin, end) for consecutive chunks of [0, count) and waits for all of them
+         * Chunks are taken on demand so slow items don't stall a whole thread
+         * The first exception thrown by fn is rethrown here once every chunk has finished
+         */
+        template <typename F>
+        void parallel_for(size_t count, size_t chunk, F&& fn)
+        {
+            if(count == 0) return;
+            chunk = std::max<size_t>(chunk, 1);
+            const size_t chunks = (count + chunk - 1) / chunk;
+
+            std::atomic<size_t> next{0};
+            std::exception_ptr error;
+            std::mutex error_mutex;
+
+            auto run = [&]() {
+                for(size_t c = next.fetch_add(1); c < chunks; c = next.fetch_add(1))
+                {
+                    try
+                    {
+                        fn(c * chunk, std::min(count, (c + 1) * chunk));
+                    }
+                    catch(...)
+                    {
+                        std::lock_guard lock(error_mutex);
+                        if(!error) error = std::current_exception();
+                    }
+                }
+            };
+
+            const size_t helpers = std::min<size_t>(workers.size(), chunks - 1);
+            std::atomic<size_t> pending{helpers};
+            std::mutex done_mutex;
+            std::condition_variable done;
+
+            {
+                std::lock_guard lock(mutex);
+                for(size_t i = 0; i < helpers; i++)
+                {
+                    jobs.emplace_back([&]() {
+                        run();
+                        std::lock_guard done_lock(done_mutex);
+                        if(pending.fetch_sub(1) == 1) done.notify_one();
+                    });
+                }
+            }
+            wake.notify_all();
+
+            run();
+
+            std::unique_lock lock(done_mutex);
+            done.wait(lock, [&]() { return pending.load() == 0; });
+
+            if(error) std::rethrow_exception(error);
+        }
+
+        //Pool sized to the machine, created on first use
+        static thread_pool& shared()
+        {
+            static thread_pool pool;
+            return pool;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef UTILS_UTF8_H
+#define UTILS_UTF8_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define UTILS_UTF8_SSE2 1
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    #include <arm_neon.h>
+    #define UTILS_UTF8_NEON 1
+#endif
+
+namespace utils
+{
+namespace utf8
+{
+    //Bytes before the first one that isn't ASCII (size if all are), 16 at a time
+    inline size_t ascii_prefix(const char* data, size_t size)
+    {
+        size_t i = 0;
+#if defined(UTILS_UTF8_SSE2)
+        for(; i + 16 <= size; i += 16)
+        {
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))));
+            if(mask) return i + static_cast<size_t>(__builtin_ctz(mask));
+        }
+#elif defined(UTILS_UTF8_NEON)
+        for(; i + 16 <= size; i += 16)
+        {
+            if(vmaxvq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(data + i))) >= 0x80) break;
+        }
+#else
+        for(; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            if(word & 0x8080808080808080ULL) break;
+        }
+#endif
+        for(; i < size; i++)
+        {
+            if(static_cast<unsigned char>(data[i]) >= 0x80) return i;
+        }
+        return size;
+    }
+
+    inline bool is_ascii(std::string_view text)
+    {
+        return ascii_prefix(text.data(), text.size()) == text.size();
+    }
+
+    struct Decoded
+    {
+        uint32_t code_point; //U+FFFD when invalid
+        uint8_t length;      //bytes used, 1 for an invalid byte
+        bool valid;
+    };
+
+    //One code point, overlong forms, surrogates and values over U+10FFFF are invalid
+    inline Decoded decode(const char* data, size_t size)
+    {
+        const auto byte = [&](size_t i) { return static_cast<unsigned char>(data[i]); };
+        const unsigned char lead = byte(0);
+        if(lead < 0x80) return {lead, 1, true};
+
+        uint8_t length;
+        uint32_t cp;
+        uint32_t min;
+        if((lead & 0xE0) == 0xC0) { length = 2; cp = lead & 0x1F; min = 0x80; }
+        else if((lead & 0xF0) == 0xE0) { length = 3; cp = lead & 0x0F; min = 0x800; }
+        else if((lead & 0xF8) == 0xF0) { length = 4; cp = lead & 0x07; min = 0x10000; }
+        else return {0xFFFD, 1, false};
+
+        if(size < length) return {0xFFFD, 1, false};
+        for(uint8_t i = 1; i < length; i++)
+        {
+            if((byte(i) & 0xC0) != 0x80) return {0xFFFD, 1, false};
+            cp = (cp << 6) | (byte(i) & 0x3F);
+        }
+        if(cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return {0xFFFD, 1, false};
+        return {cp, length, true};
+    }
+
+    //Appends cp encoded, the other side of decode
+    inline void append(std::string& out, uint32_t cp)
+    {
+        if(cp < 0x80) out += static_cast<char>(cp);
+        else if(cp < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if(cp < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    //Whole text is valid UTF-8, ASCII runs are skipped 16 bytes at a time
+    inline bool validate(std::string_view text)
+    {
+        size_t i = 0;
+        while(i < text.size())
+        {
+            i += ascii_prefix(text.data() + i, text.size() - i);
+            if(i >= text.size()) break;
+            Decoded d = decode(text.data() + i, text.size() - i);
+            if(!d.valid) return false;
+            i += d.length;
+        }
+        return true;
+    }
+
+    namespace detail
+    {
+        //Marks that stay on the character before them (combining marks, variation selectors, skin tones...)
+        constexpr bool extend(uint32_t cp)
+        {
+            return (cp >= 0x0300 && cp <= 0x036F) || (cp >= 0x0483 && cp <= 0x0489) ||
+                   (cp >= 0x0591 && cp <= 0x05BD) || (cp >= 0x0610 && cp <= 0x061A) ||
+                   (cp >= 0x064B && cp <= 0x065F) || (cp >= 0x0900 && cp <= 0x0903) ||
+                   (cp >= 0x093A && cp <= 0x094F) || (cp >= 0x0E31 && cp <= 0x0E3A && cp != 0x0E32 && cp != 0x0E33) ||
+                   (cp >= 0x0E47 && cp <= 0x0E4E) || (cp >= 0x1AB0 && cp <= 0x1AFF) ||
+                   (cp >= 0x1DC0 && cp <= 0x1DFF) || cp == 0x200C || cp == 0x200D ||
+                   (cp >= 0x20D0 && cp <= 0x20FF) || (cp >= 0x3099 && cp <= 0x309A) ||
+                   (cp >= 0xFE00 && cp <= 0xFE0F) || (cp >= 0xFE20 && cp <= 0xFE2F) ||
+                   (cp >= 0x1F3FB && cp <= 0x1F3FF) || (cp >= 0xE0020 && cp <= 0xE007F) ||
+                   (cp >= 0xE0100 && cp <= 0xE01EF);
+        }
+
+        constexpr bool regional_indicator(uint32_t cp)
+        {
+            return cp >= 0x1F1E6 && cp <= 0x1F1FF;
+        }
+    }
+
+    /**
+     * @brief End of the visible character (grapheme cluster) that starts at pos
+     * Covers what shows up in quest texts: combining accents, CR LF, emoji with
+     * modifiers and ZWJ sequences, flags. Not the full Unicode rules (no Hangul jamo or Indic conjuncts)
+     * Invalid bytes are a character each
+     */
+    inline size_t next_cluster(std::string_view text, size_t pos)
+    {
+        const size_t size = text.size();
+        if(pos >= size) return size;
+
+        const unsigned char lead = static_cast<unsigned char>(text[pos]);
+        //ASCII followed by ASCII, the common case
+        if(lead < 0x80 && (pos + 1 >= size || static_cast<unsigned char>(text[pos + 1]) < 0x80))
+        {
+            return lead == '\r' && pos + 1 < size && text[pos + 1] == '\n' ? pos + 2 : pos + 1;
+        }
+
+        Decoded first = decode(text.data() + pos, size - pos);
+        size_t end = pos + first.length;
+        if(!first.valid) return end;
+
+        bool joined = false; //last one was a zero width joiner
+        bool pair_open = detail::regional_indicator(first.code_point);
+        while(end < size)
+        {
+            if(static_cast<unsigned char>(text[end]) < 0x80) break;
+            Decoded next = decode(text.data() + end, size - end);
+            if(!next.valid) break;
+
+            if(joined || detail::extend(next.code_point))
+            {
+                joined = next.code_point == 0x200D;
+            }
+            else if(pair_open && detail::regional_indicator(next.code_point))
+            {
+                pair_open = false;
+            }
+            else
+            {
+                break;
+            }
+            end += next.length;
+        }
+        return end;
+    }
+
+    inline size_t count_clusters(std::string_view text)
+    {
+        size_t count = 0;
+        for(size_t pos = 0; pos < text.size(); pos = next_cluster(text, pos)) count++;
+        return count;
+    }
+}
+}
+
+#endif
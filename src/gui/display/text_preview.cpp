@@ -0,0 +1,235 @@
+#include <gui/display/text_preview.h>
+#include <parser/layout.h>
+#include <parser/raw.h>
+#include <utils/hash.h>
+#include <utils/utf8.h>
+
+#include <array>
+#include <bit>
+#include <charconv>
+
+namespace {
+    constexpr float LINE_HEIGHT = 9.0f; // Minecraft pixels
+    constexpr float PADDING = 4.0f;
+    constexpr float ITALIC_SLANT = 0.25f; // the top of a glyph leans right this much per pixel of height
+
+    ImU32 toColor(raw::gradient::rgb rgb, uint8_t alpha = 255) {
+        return IM_COL32((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF, alpha);
+    }
+
+    // Printable ASCII grouped by advance, what an obfuscated character can turn into
+    const std::array<std::vector<ImWchar>, 8>& glyphsByAdvance() {
+        static const std::array<std::vector<ImWchar>, 8> groups = [] {
+            std::array<std::vector<ImWchar>, 8> result;
+            for (ImWchar c = 33; c < 127; c++) {
+                result[raw::layout::advance(c)].push_back(c);
+            }
+            return result;
+        }();
+        return groups;
+    }
+}
+
+void TextPreview::layout(const std::string& markup, raw::gradient::Mode mode, float delta_e) {
+    glyphs.clear();
+    rules.clear();
+    obfuscated.clear();
+
+    // the breaks are the ones raw::layout::fit puts in (it expands the gradients too), here every '\n' is a new line
+    raw::layout::Options fit;
+    fit.gradient = mode;
+    fit.delta_e = delta_e;
+    const std::string wrapped = raw::layout::fit(markup, fit);
+    raw::detail::Components ir;
+    raw::detail::parse_components(wrapped, ir);
+
+    const int width = fit.width;
+    int x = 0;
+    float y = 0.0f;
+
+    auto new_line = [&]() {
+        x = 0;
+        y += LINE_HEIGHT;
+    };
+
+    for (const auto& component : ir.list) {
+        if (component.page_break) {
+            new_line();
+            rules.push_back({ImVec2(0.0f, y + 4.0f), ImVec2(static_cast<float>(width), y + 5.0f), IM_COL32(128, 128, 128, 160)});
+            new_line();
+            continue;
+        }
+
+        const raw::detail::State& state = component.state;
+        raw::gradient::rgb rgb = 0xFFFFFF;
+        raw::gradient::parse_rgb(state.color, rgb);
+        ImU32 shadow = 0;
+        if (!state.shadow.empty()) {
+            uint32_t argb = 0;
+            std::from_chars(state.shadow.data(), state.shadow.data() + state.shadow.size(), argb);
+            shadow = toColor(argb & 0xFFFFFF, static_cast<uint8_t>(argb >> 24));
+        }
+        const uint8_t flags = (state.bold ? BOLD : 0) | (state.italic ? ITALIC : 0) |
+                              (state.underlined ? UNDERLINED : 0) | (state.strikethrough ? STRIKETHROUGH : 0) |
+                              (state.obfuscated ? OBFUSCATED : 0);
+
+        const std::string_view text = ir.textOf(component);
+        for (size_t pos = 0, end; pos < text.size(); pos = end) {
+            end = utils::utf8::next_cluster(text, pos);
+            if (text[pos] == '\n' || text[pos] == '\r') {
+                new_line();
+                continue;
+            }
+
+            const int advance = raw::layout::cluster_advance(text, pos, end, state.bold);
+            const uint32_t code_point = static_cast<unsigned char>(text[pos]) < 0x80
+                ? static_cast<unsigned char>(text[pos])
+                : utils::utf8::decode(text.data() + pos, end - pos).code_point;
+            glyphs.push_back({static_cast<float>(x), y, static_cast<ImWchar>(code_point <= 0xFFFF ? code_point : '?'),
+                              flags, static_cast<uint8_t>(advance), toColor(rgb), shadow});
+            x += advance;
+        }
+    }
+
+    // decorations are known once the lines are final, neighbours become one rule
+    for (size_t i = 0; i < glyphs.size(); i++) {
+        const Glyph& glyph = glyphs[i];
+        if (glyph.flags & OBFUSCATED) obfuscated.push_back(i);
+
+        auto add_rule = [&](float top) {
+            const ImVec2 from(glyph.x, glyph.y + top);
+            const ImVec2 to(glyph.x + glyph.advance, glyph.y + top + 1.0f);
+            if (!rules.empty() && rules.back().to.x == from.x && rules.back().from.y == from.y && rules.back().color == glyph.color) {
+                rules.back().to.x = to.x;
+                return;
+            }
+            rules.push_back({from, to, glyph.color});
+        };
+        if (glyph.flags & UNDERLINED) add_rule(LINE_HEIGHT - 1.0f);
+        if (glyph.flags & STRIKETHROUGH) add_rule(3.5f);
+    }
+
+    content_size = ImVec2(width + PADDING * 2.0f, y + LINE_HEIGHT + PADDING * 2.0f);
+}
+
+void TextPreview::drawGlyph(ImDrawList* draw_list, const Glyph& glyph, ImVec2 origin, ImWchar c) const {
+    ImFont* font = ImGui::GetFont();
+    const float size = ImGui::GetFontSize();
+    const ImVec2 at(origin.x + (glyph.x + PADDING) * pixel, origin.y + (glyph.y + PADDING) * pixel);
+
+    auto put = [&](float dx, float dy, ImU32 color) {
+        const int first = draw_list->VtxBuffer.Size;
+        font->RenderChar(draw_list, size, ImVec2(at.x + dx, at.y + dy), color, c);
+        if (glyph.flags & ITALIC) {
+            const float bottom = at.y + dy + (LINE_HEIGHT - 1.0f) * pixel;
+            for (int i = first; i < draw_list->VtxBuffer.Size; i++) {
+                ImDrawVert& vertex = draw_list->VtxBuffer[i];
+                vertex.pos.x += (bottom - vertex.pos.y) * ITALIC_SLANT;
+            }
+        }
+    };
+
+    // Minecraft draws bold by drawing the glyph again one pixel to the right
+    if (glyph.shadow) {
+        put(pixel, pixel, glyph.shadow);
+        if (glyph.flags & BOLD) put(pixel * 2.0f, pixel, glyph.shadow);
+    }
+    put(0.0f, 0.0f, glyph.color);
+    if (glyph.flags & BOLD) put(pixel, 0.0f, glyph.color);
+}
+
+void TextPreview::drawStatic(ImDrawList* draw_list, ImVec2 origin) {
+    const int first_vertex = draw_list->VtxBuffer.Size;
+    const int first_index = draw_list->IdxBuffer.Size;
+    const unsigned int base = draw_list->_VtxCurrentIdx;
+    const int commands = draw_list->CmdBuffer.Size;
+
+    for (const Rule& rule : rules) {
+        draw_list->AddRectFilled(ImVec2(origin.x + (rule.from.x + PADDING) * pixel, origin.y + (rule.from.y + PADDING) * pixel),
+                                 ImVec2(origin.x + (rule.to.x + PADDING) * pixel, origin.y + (rule.to.y + PADDING) * pixel),
+                                 rule.color);
+    }
+    for (const Glyph& glyph : glyphs) {
+        if (!(glyph.flags & OBFUSCATED) && glyph.c != ' ') drawGlyph(draw_list, glyph, origin, glyph.c);
+    }
+
+    // a new draw command in between (clip change, too many vertices) and the copy wouldn't be valid
+    if (draw_list->CmdBuffer.Size != commands) return;
+
+    vertices.assign(draw_list->VtxBuffer.Data + first_vertex, draw_list->VtxBuffer.Data + draw_list->VtxBuffer.Size);
+    for (ImDrawVert& vertex : vertices) {
+        vertex.pos.x -= origin.x;
+        vertex.pos.y -= origin.y;
+    }
+    indices.resize(draw_list->IdxBuffer.Size - first_index);
+    for (size_t i = 0; i < indices.size(); i++) {
+        indices[i] = static_cast<ImDrawIdx>(draw_list->IdxBuffer[first_index + static_cast<int>(i)] - base);
+    }
+    captured = true;
+}
+
+void TextPreview::emitCached(ImDrawList* draw_list, ImVec2 origin) const {
+    if (vertices.empty()) return;
+
+    // one reserve for the whole text, then it's a copy
+    draw_list->PrimReserve(static_cast<int>(indices.size()), static_cast<int>(vertices.size()));
+    const unsigned int base = draw_list->_VtxCurrentIdx;
+    ImDrawVert* vertex_out = draw_list->_VtxWritePtr;
+    for (const ImDrawVert& vertex : vertices) {
+        *vertex_out = vertex;
+        vertex_out->pos.x += origin.x;
+        vertex_out->pos.y += origin.y;
+        vertex_out++;
+    }
+    ImDrawIdx* index_out = draw_list->_IdxWritePtr;
+    for (ImDrawIdx index : indices) *index_out++ = static_cast<ImDrawIdx>(base + index);
+
+    draw_list->_VtxWritePtr = vertex_out;
+    draw_list->_IdxWritePtr = index_out;
+    draw_list->_VtxCurrentIdx += static_cast<unsigned int>(vertices.size());
+}
+
+ImWchar TextPreview::randomGlyph(uint8_t advance) {
+    const auto& group = glyphsByAdvance()[advance < 8 ? advance : 6];
+    if (group.empty()) return '?';
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return group[random_state % group.size()];
+}
+
+void TextPreview::draw(const std::string& markup, raw::gradient::Mode mode, float delta_e, float height) {
+    const float new_pixel = ImGui::GetFontSize() / LINE_HEIGHT;
+    const uint64_t key = utils::hash64(markup, utils::combine(static_cast<uint64_t>(mode), std::bit_cast<uint32_t>(delta_e)));
+    if (key != source_key || new_pixel != pixel) {
+        source_key = key;
+        pixel = new_pixel;
+        layout(markup, mode, delta_e);
+        captured = false;
+    }
+    // the atlas was built again (fonts changed), the cached texture coordinates are stale
+    const ImVec2 white = ImGui::GetFontTexUvWhitePixel();
+    if (white.x != atlas_white.x || white.y != atlas_white.y) {
+        atlas_white = white;
+        captured = false;
+    }
+
+    ImGui::BeginChild("##preview", ImVec2(0.0f, height), ImGuiChildFlags_Borders, ImGuiWindowFlags_HorizontalScrollbar);
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const ImVec2 size(content_size.x * pixel, content_size.y * pixel);
+
+    // the quest panel's background
+    draw_list->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(16, 16, 16, 230));
+    if (captured) emitCached(draw_list, origin);
+    else drawStatic(draw_list, origin);
+
+    for (size_t index : obfuscated) {
+        const Glyph& glyph = glyphs[index];
+        const uint8_t plain_advance = glyph.flags & BOLD ? glyph.advance - 1 : glyph.advance;
+        drawGlyph(draw_list, glyph, origin, randomGlyph(plain_advance));
+    }
+
+    ImGui::Dummy(size);
+    ImGui::EndChild();
+}
@@ -10,11 +10,16 @@
 #include <backward.hpp>
 
 #include <parser/raw.h>
+#include <parser/cache.h>
+#include <parser/incremental.h>
+#include <parser/reverse.h>
+#include <parser/effects.h>
 #include <integration/kubejs.h>
 #include <gui/display/Image.h>
 #include <gui/display/window.h>
 #include <gui/display/button_slow_tooltip.h>
 #include <gui/display/textfield_selection.h>
+#include <gui/display/text_preview.h>
 
 #include <string>
 #include <fstream>
@@ -39,6 +44,18 @@ int main()
     std::string inputText2 = "";
     
     int selected_option = 0;
+    int selected_gradient = 0;
+    bool minimize_output = false;
+    float gradient_delta_e = 0.0f;
+    raw::Report quantize_report; // from the last full conversion, live updates don't measure it
+    bool live_preview = true;
+    raw::Report last_report;
+    raw::IncrementalConverter live_converter;
+    TextPreview text_preview;
+    bool show_preview = true;
+    raw::ConversionCache conversion_cache; // pressing Convert again (or after an undo) costs a lookup
+    std::string effects_checked_text;
+    std::vector<raw::effects::Issue> effect_issues;
 
     ImGuiStyle& style = ImGui::GetStyle();
     style.Colors[ImGuiCol_WindowBg] = ImVec4(0.0f, 0.0f, 0.1f, 0.9f);
@@ -124,6 +141,7 @@ int main()
     std::vector<FormatButtonData> actionButtons = {
         {"Convert", "", "Convert text to JSON format and copy to clipboard"}, 
         {"Copy Text Output", "", "Copy converted text to clipboard"}, 
+        {"Import JSON", "", "Turn JSON text from the clipboard back into & codes"}, 
         {"Reload Minecraft (Not yet)", "", "Reload Minecraft scripts (requires KubeJS)"},
         {"Change zoom", "", "Changes zoom level from 1 to 4"},
         {"Exit", "", "Close the application"}
@@ -239,10 +257,71 @@ int main()
         ImGui::RadioButton("Extra", &selected_option, 1);
         ImGui::SameLine();
 
+        ImGui::Text("Gradient:");
+        ImGui::SameLine();
+        ImGui::RadioButton("sRGB", &selected_gradient, static_cast<int>(raw::gradient::Mode::SRGB));
+        ImGui::SameLine();
+        ImGui::RadioButton("OKLab", &selected_gradient, static_cast<int>(raw::gradient::Mode::OKLAB));
+        ImGui::SameLine();
+        ImGui::RadioButton("HSV", &selected_gradient, static_cast<int>(raw::gradient::Mode::HSV));
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(80.0f);
+        ImGui::SliderFloat("Delta E", &gradient_delta_e, 0.0f, 10.0f, "%.1f");
+        if(ImGui::IsItemHovered()) ImGui::SetTooltip("Gradient characters this close in color share one (0 = off, ~2 is hard to notice)");
+        if(gradient_delta_e > 0.0f && quantize_report.quantized_components > 0)
+        {
+            ImGui::SameLine();
+            ImGui::Text("(-%zu components, -%zu bytes)", quantize_report.quantized_components, quantize_report.quantized_bytes);
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Minimize", &minimize_output);
+        if(minimize_output && last_report.original_bytes > 0)
+        {
+            ImGui::SameLine();
+            ImGui::Text("(%zu -> %zu bytes)", last_report.original_bytes, last_report.output_bytes);
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Live", &live_preview);
+        ImGui::SameLine();
+        ImGui::Checkbox("Preview", &show_preview);
+
+        raw::Options options;
+        options.use_extra = selected_option ? true : false;
+        options.gradient = static_cast<raw::gradient::Mode>(selected_gradient);
+        options.minimize = minimize_output;
+        options.delta_e = gradient_delta_e;
+
+        // Only the pieces of text that changed are converted again
+        if(live_preview && live_converter.update(editorState.text, options))
+        {
+            inputText2 = live_converter.output();
+            last_report = live_converter.lastReport();
+        }
+
+        // Mod effect tags are checked again only when the text changes
+        if(editorState.text != effects_checked_text)
+        {
+            effects_checked_text = editorState.text;
+            effect_issues = raw::effects::parse(effects_checked_text).issues;
+        }
+        if(!effect_issues.empty())
+        {
+            const auto& first = effect_issues.front();
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Effects: %zu problem(s), %zu:%zu %s",
+                effect_issues.size(), first.line, first.column, first.message.c_str());
+        }
+
+        // How it looks in game, the geometry is only built again when the text changes
+        if(show_preview)
+        {
+            text_preview.draw(editorState.text, options.gradient, options.delta_e, ImGui::GetTextLineHeight() * 10);
+        }
+
         // Action buttons
         size_t action_idx = 0;
         generateSlowedButton(actionButtons[action_idx++], [&](){
-            inputText2 = raw::to_json(editorState.text, selected_option ? true : false);
+            inputText2 = conversion_cache.convert(editorState.text, options, &last_report);
+            quantize_report = last_report;
             ImGui::SetClipboardText(inputText2.c_str());
         });
         ImGui::SameLine();
@@ -251,6 +330,19 @@ int main()
             ImGui::SetClipboardText(inputText2.c_str());
         });
         ImGui::SameLine();
+
+        generateSlowedButton(actionButtons[action_idx++], [&](){
+            const char* clipboard = ImGui::GetClipboardText();
+            try
+            {
+                editorState.text = raw::from_json(clipboard ? clipboard : "");
+            }
+            catch(const raw::reverse::ParseError& e)
+            {
+                inputText2 = std::string("Invalid JSON: ") + e.what();
+            }
+        });
+        ImGui::SameLine();
         
         generateSlowedButton(actionButtons[action_idx++], [&](){
             if(!client.connect()) inputText2 = "Couldn't connect to server";
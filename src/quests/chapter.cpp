@@ -1,9 +1,9 @@
 #include <quests/chapter.h>
 #include <quests/chapter_group.h>
-#include <sstream>
 #include <filesystem>
-#include <fstream>
 #include <quests/uuid.h>
+#include <quests/quest_store.h>
+#include <utils/atomic_file.h>
 
 chapter::chapter()
 {
@@ -43,99 +43,121 @@ void chapter::changeIcon(std::string icon_id)
     this->icon = icon_id;
 }
 
-bool chapter::addQuest(quest q)
+const std::string& chapter::getId() const
 {
-    for(auto quest : this->quests)
-    {
-        if(q == quest)
-        {
-            return false;
-        }
-    }
-    this->quests.push_back(q);
-    return true;
+    return this->id;
 }
 
-bool chapter::removeQuest(quest q)
+bool chapter::addQuest(quest_handle q, const std::string& quest_id)
 {
-    for(auto quest : this->quests)
+    auto [it, inserted] = this->quest_index.try_emplace(quest_id, this->quests.size());
+    if(!inserted)
     {
-        if(quest == q)
-        {
-            return true;
-        }
+        return false;
     }
-    return false;
+    this->quests.push_back(q);
+    return true;
 }
 
-bool chapter::generateQuestFile()
+//O(1), the last quest takes the place of the removed one
+bool chapter::removeQuest(std::string_view quest_id, const quests::slot_map<quest>& all_quests)
 {
-    std::stringstream ss;
-    const std::string indent0(4, ' ');
-    const std::string indent1(8, ' ');
-    const std::string indent2(12, ' ');
-
-    // Inicio del objeto
-    ss << "{\n";
-
-    // Propiedades del chapter
-    if(!autofocus.empty())
+    auto it = this->quest_index.find(quest_id);
+    if(it == this->quest_index.end())
     {
-        ss << indent0 << "autofocus_id: \"" << autofocus << "\"\n";
+        return false;
     }
 
-    ss << indent0 << "default_hide_dependency_lines: " 
-       << (hide_dependency_lines ? "true" : "false") << "\n";
-    
-    ss << indent0 << "default_quest_shape: \"\"\n";
-    ss << indent0 << "filename: \"" << file_name << "\"\n";
-    
-    ss << indent0 << "group: \"" << (group.empty() ? "" : group) << "\"\n";
-    
-    if(!icon.empty())
+    const size_t slot = it->second;
+    if(this->autofocus == quest_id)
     {
-        ss << indent0 << "icon: {\n" 
-           << indent1 << "id: \"" << icon << "\"\n" 
-           << indent0 << "}\n";
+        this->autofocus.clear();
     }
-    
-    ss << indent0 << "id: \"" << id << "\"\n";
-    ss << indent0 << "order_index: " << std::to_string(order) << "\n";
-    
-    // Array de quests
-    ss << indent0 << "quests: [\n";
-    for(auto q : quests)
+    this->quest_index.erase(it);
+
+    //swap and pop, the index entry of the moved handle follows it
+    if(slot + 1 != this->quests.size())
     {
-        std::istringstream rs(q.generateQuest());
-        std::string line;
-        while(std::getline(rs, line))
-        {
-            if(!line.empty())
-            {
-                ss << indent1 << line << "\n";
-            }
-        }
+        this->quests[slot] = this->quests.back();
+        this->quest_index.find(all_quests.get(this->quests[slot])->id)->second = slot;
     }
-    ss << indent0 << "]\n";
-    
-    // Cierre del objeto
-    ss << "}\n";
-
-    // Crear directorio si no existe
-    std::filesystem::path dir("chapter");
-    if(!std::filesystem::exists(dir))
+    this->quests.pop_back();
+    return true;
+}
+
+quest_handle chapter::findQuest(std::string_view quest_id) const
+{
+    auto it = this->quest_index.find(quest_id);
+    return it != this->quest_index.end() ? this->quests[it->second] : quest_handle{};
+}
+
+const std::vector<quest_handle>& chapter::getQuests() const
+{
+    return this->quests;
+}
+
+size_t chapter::questCount() const
+{
+    return this->quests.size();
+}
+
+std::string chapter::fileName() const
+{
+    return this->file_name.empty() ? this->id : this->file_name;
+}
+
+void chapter::writeQuestText(std::string& out, const quest_store& store) const
+{
+    quests::snbt_writer w(out);
+    w.beginObject();
+    if(!this->autofocus.empty()) w.string("autofocus_id", this->autofocus);
+    w.boolean("default_hide_dependency_lines", this->hide_dependency_lines);
+    w.string("default_quest_shape", "");
+    w.string("filename", this->fileName());
+    w.string("group", this->group);
+    if(!this->icon.empty())
     {
-        std::filesystem::create_directory(dir);
+        w.beginObject("icon");
+        w.string("id", this->icon);
+        w.endObject();
     }
+    w.string("id", this->id);
+    w.integer("order_index", this->order);
+    if(!this->quest_links.empty()) w.stringList("quest_links", this->quest_links);
 
-    // Escribir archivo
-    std::ofstream file(dir / (file_name + ".snbt"));
-    if(file.is_open())
+    //every quest goes straight into out, already at its level
+    w.beginList("quests");
+    for(quest_handle h : this->quests)
     {
-        file << ss.str();
-        file.close();
-        return true;
+        store.getQuest(h)->write(w);
     }
-    file.close();
-    return false;
-}
\ No newline at end of file
+    w.endList();
+    w.endObject();
+}
+
+std::string chapter::generateQuestText(const quest_store& store) const
+{
+    std::string out;
+    out.reserve(256 + this->quests.size() * 512);
+    this->writeQuestText(out, store);
+    return out;
+}
+
+bool chapter::generateQuestFile(const quest_store& store, const std::filesystem::path& root)
+{
+    utils::atomic_writer writer;
+    return writer.stage(root / "chapters" / (this->fileName() + ".snbt"), this->generateQuestText(store)) && writer.commit();
+}
+
+void chapter::read(const snbt::Compound& values)
+{
+    const quests::snbt_reader r(values);
+    r.string("autofocus_id", this->autofocus);
+    r.boolean("default_hide_dependency_lines", this->hide_dependency_lines);
+    r.string("filename", this->file_name);
+    r.string("group", this->group);
+    r.itemId("icon", this->icon);
+    r.string("id", this->id);
+    r.number("order_index", this->order);
+    r.stringList("quest_links", this->quest_links);
+}
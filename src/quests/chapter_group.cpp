@@ -1,13 +1,435 @@
 #include <quests/chapter_group.h>
+#include <quests/snbt_reader.h>
+#include <quests/snbt_writer.h>
+#include <utils/atomic_file.h>
+#include <utils/hash.h>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
 
 chapter_group::chapter_group()
 {
-    this->chapters.push_back(chapter());
+    this->store.addChapter(chapter());
 }
 
 chapter_group::~chapter_group(){}
 
-std::vector<std::string> chapter_group::getChapterGroup()
+quest_store& chapter_group::getStore()
+{
+    return this->store;
+}
+
+const quest_store& chapter_group::getStore() const
+{
+    return this->store;
+}
+
+const quests::slot_map<chapter>& chapter_group::getChapters() const
+{
+    return this->store.allChapters();
+}
+
+const std::vector<std::string>& chapter_group::getChapterGroup() const
 {
     return this->chapters_group;
-}
\ No newline at end of file
+}
+
+const quests::slot_map<reward>& chapter_group::getRewardTables() const
+{
+    return this->store.allRewardTables();
+}
+
+const snbt::Compound& chapter_group::getData() const
+{
+    return this->data;
+}
+
+reward_handle chapter_group::addRewardTable(reward&& table)
+{
+    return this->store.addRewardTable(std::move(table));
+}
+
+chapter* chapter_group::selectChapter(chapter_handle handle)
+{
+    return this->store.getChapter(handle);
+}
+bool chapter_group::onDisk(const std::filesystem::path& path, const written_file& content) const
+{
+    std::error_code ec;
+    const uintmax_t size = std::filesystem::file_size(path, ec);
+    if(ec || size != content.size) return false;
+
+    auto it = this->manifest.find(path.generic_string());
+    if(it != this->manifest.end()) return it->second.hash == content.hash;
+
+    std::ifstream file(path, std::ios::binary);
+    std::string text(size, '\0');
+    file.read(text.data(), static_cast<std::streamsize>(size));
+    return static_cast<uintmax_t>(file.gcount()) == size && utils::hash64(text) == content.hash;
+}
+
+std::string chapter_group::generateData(const std::filesystem::path& root, utils::thread_pool& pool, bool durable)
+{
+    utils::atomic_writer writer(durable);
+    //only read from here, the non-const getters would mark everything dirty
+    const quest_store& pack = this->store;
+
+    //what each file ended up as, the manifest is only read until the files are committed
+    struct result
+    {
+        std::string key;
+        written_file content;
+        bool serialized = false;
+        bool staged = false;
+    };
+    const auto& chapter_list = pack.allChapters();
+    const auto& tables = pack.allRewardTables();
+    std::vector<result> results(2 + chapter_list.size() + tables.size());
+
+    auto clean = [&](bool dirty, const std::filesystem::path& path) {
+        std::error_code ec;
+        return !dirty && this->manifest.contains(path.generic_string()) && std::filesystem::exists(path, ec);
+    };
+    auto stageChanged = [&](result& file, const std::filesystem::path& path, const std::string& text) {
+        file.content = {utils::hash64(text), text.size()};
+        file.serialized = true;
+        if(!this->onDisk(path, file.content)) file.staged = writer.stage(path, text);
+    };
+
+    results[0].key = (root / "chapter_groups.snbt").generic_string();
+    if(!clean(this->pack_dirty, root / "chapter_groups.snbt"))
+    {
+        std::string groups;
+        quests::snbt_writer w(groups);
+        w.beginObject();
+        w.beginList("chapter_groups");
+        for(const auto& group_id : this->chapters_group)
+        {
+            w.beginObject();
+            w.string("id", group_id);
+            w.endObject();
+        }
+        w.endList();
+        w.endObject();
+        stageChanged(results[0], root / "chapter_groups.snbt", groups);
+    }
+
+    if(!this->data.empty()) results[1].key = (root / "data.snbt").generic_string();
+    if(!this->data.empty() && !clean(this->pack_dirty, root / "data.snbt"))
+    {
+        std::string pack_data;
+        quests::snbt_writer d(pack_data);
+        d.beginObject();
+        for(const auto& [key, value] : this->data) d.tag(key, value);
+        d.endObject();
+        stageChanged(results[1], root / "data.snbt", pack_data);
+    }
+
+    //one job per file, chapters first (they're the big ones)
+    pool.parallel_for(chapter_list.size() + tables.size(), 1, [&](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++)
+        {
+            if(i < chapter_list.size())
+            {
+                const chapter_handle h = chapter_list.handleAt(i);
+                const chapter& c = *chapter_list.get(h);
+                const std::filesystem::path path = root / "chapters" / (c.fileName() + ".snbt");
+                results[2 + i].key = path.generic_string();
+                if(!clean(pack.isDirty(h), path)) stageChanged(results[2 + i], path, c.generateQuestText(pack));
+            }
+            else
+            {
+                const reward_handle h = tables.handleAt(i - chapter_list.size());
+                const reward& table = *pack.getRewardTable(h);
+                const std::filesystem::path path = root / "reward_tables" / (table.id + ".snbt");
+                results[2 + i].key = path.generic_string();
+                if(!clean(pack.isDirty(h), path)) stageChanged(results[2 + i], path, table.generateReward());
+            }
+        }
+    });
+
+    this->last_serialized = 0;
+    this->last_written = writer.pending();
+    for(const result& file : results) this->last_serialized += file.serialized;
+
+    //files written or imported before that the pack doesn't have anymore (removed, or a chapter renamed)
+    //go in the same commit, FTB would load them back. Only a removal or a serialized chapter can leave one
+    std::vector<std::string> stale;
+    if(pack.hasRemovals() || this->last_serialized != 0)
+    {
+        std::unordered_set<std::string_view> produced;
+        produced.reserve(results.size());
+        for(const result& file : results) produced.insert(file.key);
+        const std::string chapters_folder = (root / "chapters").generic_string();
+        const std::string tables_folder = (root / "reward_tables").generic_string();
+        for(const auto& [key, content] : this->manifest)
+        {
+            const std::string folder = std::filesystem::path(key).parent_path().generic_string();
+            if((folder == chapters_folder || folder == tables_folder) && !produced.contains(key))
+            {
+                writer.stageRemoval(key);
+                stale.push_back(key);
+            }
+        }
+    }
+    this->last_removed = stale.size();
+
+    const bool written = writer.commit(pool);
+    std::string errors;
+    for(const auto& error : writer.errors())
+    {
+        errors += error;
+        errors += '\n';
+    }
+    //a failed export stays dirty, the next one tries again
+    if(written && errors.empty())
+    {
+        for(result& file : results)
+        {
+            if(file.serialized) this->manifest[std::move(file.key)] = file.content;
+        }
+        for(const std::string& key : stale) this->manifest.erase(key);
+        this->store.clearDirty();
+        this->pack_dirty = false;
+    }
+    return errors;
+}
+
+size_t chapter_group::lastSerialized() const
+{
+    return this->last_serialized;
+}
+
+size_t chapter_group::lastWritten() const
+{
+    return this->last_written;
+}
+
+size_t chapter_group::lastRemoved() const
+{
+    return this->last_removed;
+}
+
+namespace
+{
+    enum class pack_file {DATA, GROUPS, CHAPTER, REWARD_TABLE};
+
+    //One file of the pack, parsed and turned into the model on the pool
+    struct loaded_file
+    {
+        pack_file kind;
+        std::filesystem::path path;
+        std::string error;
+        //what was read, it's in the manifest once the pack is loaded
+        uint64_t hash = 0;
+        uint64_t size = 0;
+
+        snbt::Compound values; //data.snbt is kept as it is
+        std::vector<std::string> groups;
+        chapter loaded_chapter;
+        std::vector<quest> quests;
+        reward table;
+
+        loaded_file(pack_file kind, std::filesystem::path path) : kind(kind), path(std::move(path)) {}
+    };
+
+    snbt::Compound parseFile(loaded_file& loaded)
+    {
+        const std::filesystem::path& path = loaded.path;
+        std::ifstream file(path, std::ios::binary);
+        if(!file) throw std::runtime_error("can't be opened");
+        std::string text;
+        text.resize_and_overwrite(std::filesystem::file_size(path), [&](char* buffer, size_t size) {
+            file.read(buffer, static_cast<std::streamsize>(size));
+            return static_cast<size_t>(file.gcount());
+        });
+        loaded.hash = utils::hash64(text);
+        loaded.size = text.size();
+
+        snbt::Tag root = snbt::Parser(text).parse();
+        if(root.type() != snbt::Tag::Type::Compound) throw std::runtime_error("isn't a compound");
+        quests::unescapeStrings(root);
+        return std::move(root.as<snbt::Compound>());
+    }
+
+    void loadFile(loaded_file& file)
+    {
+        snbt::Compound values = parseFile(file);
+        const quests::snbt_reader r(values);
+        switch(file.kind)
+        {
+            case pack_file::DATA:
+                file.values = std::move(values);
+                break;
+            case pack_file::GROUPS:
+                if(const snbt::List* list = r.list("chapter_groups"))
+                {
+                    for(const snbt::Tag& group : *list)
+                    {
+                        std::string id;
+                        if(group.type() == snbt::Tag::Type::Compound && quests::snbt_reader(group.as<snbt::Compound>()).string("id", id))
+                        {
+                            file.groups.push_back(std::move(id));
+                        }
+                    }
+                }
+                break;
+            case pack_file::CHAPTER:
+                file.loaded_chapter.read(values);
+                if(const snbt::List* list = r.list("quests"))
+                {
+                    file.quests.reserve(list->size());
+                    for(const snbt::Tag& item : *list)
+                    {
+                        if(item.type() == snbt::Tag::Type::Compound) file.quests.emplace_back().read(item.as<snbt::Compound>());
+                    }
+                }
+                break;
+            case pack_file::REWARD_TABLE:
+                file.table.read(values);
+                break;
+        }
+    }
+
+    //The .snbt files of a folder, sorted so a pack always loads in the same order
+    void listFiles(const std::filesystem::path& folder, pack_file kind, std::vector<loaded_file>& files)
+    {
+        std::error_code ec;
+        std::vector<std::filesystem::path> found;
+        for(const auto& entry : std::filesystem::directory_iterator(folder, ec))
+        {
+            if(entry.is_regular_file() && entry.path().extension() == ".snbt") found.push_back(entry.path());
+        }
+        std::sort(found.begin(), found.end());
+        for(auto& path : found) files.emplace_back(kind, std::move(path));
+    }
+}
+
+std::string chapter_group::loadData(const std::filesystem::path& root, utils::thread_pool& pool)
+{
+    if(!std::filesystem::is_directory(root))
+    {
+        return root.string() + ": not a folder\n";
+    }
+
+    std::vector<loaded_file> files;
+    if(std::filesystem::exists(root / "data.snbt")) files.emplace_back(pack_file::DATA, root / "data.snbt");
+    if(std::filesystem::exists(root / "chapter_groups.snbt")) files.emplace_back(pack_file::GROUPS, root / "chapter_groups.snbt");
+    listFiles(root / "chapters", pack_file::CHAPTER, files);
+    listFiles(root / "reward_tables", pack_file::REWARD_TABLE, files);
+
+    //one job per file, each one only touches its own entry
+    pool.parallel_for(files.size(), 1, [&](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++)
+        {
+            try
+            {
+                loadFile(files[i]);
+            }
+            catch(const std::exception& e)
+            {
+                files[i].error = files[i].path.string() + ": " + e.what();
+            }
+        }
+    });
+
+    std::string errors;
+    for(const loaded_file& file : files)
+    {
+        if(!file.error.empty()) errors += file.error + '\n';
+    }
+    if(!errors.empty()) return errors;
+
+    size_t quest_count = 0;
+    size_t chapter_count = 0;
+    for(const loaded_file& file : files)
+    {
+        if(file.kind != pack_file::CHAPTER) continue;
+        quest_count += file.quests.size();
+        chapter_count++;
+    }
+
+    quest_store loaded;
+    loaded.reserve(quest_count, chapter_count);
+    std::vector<std::string> groups;
+    snbt::Compound pack_data;
+
+    //the quests first, dependencies can point to any chapter
+    std::vector<std::pair<quest_handle, std::vector<std::string>>> pending;
+    pending.reserve(quest_count);
+    for(loaded_file& file : files)
+    {
+        switch(file.kind)
+        {
+            case pack_file::DATA:
+                pack_data = std::move(file.values);
+                break;
+            case pack_file::GROUPS:
+                groups = std::move(file.groups);
+                break;
+            case pack_file::CHAPTER:
+            {
+                const chapter_handle c = loaded.addChapter(std::move(file.loaded_chapter));
+                for(quest& q : file.quests)
+                {
+                    //link() fills them again, in the same order
+                    std::vector<std::string> needs = std::move(q.needs_node_completed);
+                    q.needs_node_completed.clear();
+                    const quest_handle h = loaded.addQuest(c, std::move(q));
+                    if(!h)
+                    {
+                        errors += file.path.string() + ": quest " + q.id + " is already in the pack\n";
+                        continue;
+                    }
+                    if(!needs.empty()) pending.emplace_back(h, std::move(needs));
+                }
+                break;
+            }
+            case pack_file::REWARD_TABLE:
+                loaded.addRewardTable(std::move(file.table));
+                break;
+        }
+    }
+
+    //linked all at once, one by one every dependency against the order of the graph walks most of it
+    std::vector<std::pair<quest_handle, quest_handle>> links;
+    for(auto& [h, needs] : pending)
+    {
+        for(const std::string& dependency : needs)
+        {
+            const quest_handle from = loaded.findQuest(dependency);
+            if(!from)
+            {
+                errors += "quest " + loaded.getQuest(h)->id + " depends on " + dependency + ", which isn't in the pack\n";
+            }
+            else
+            {
+                links.emplace_back(from, h);
+            }
+        }
+    }
+    const std::vector<bool> linked = loaded.linkAll(links);
+    for(size_t i = 0; i < links.size(); i++)
+    {
+        if(linked[i]) continue;
+        errors += "quest " + loaded.getQuest(links[i].second)->id + " depending on " + loaded.getQuest(links[i].first)->id +
+                  " closes a loop\n";
+    }
+    if(!errors.empty()) return errors;
+
+    this->store = std::move(loaded);
+    this->chapters_group = std::move(groups);
+    this->data = std::move(pack_data);
+
+    //the pack is what's on disk, exporting it again writes nothing until something changes
+    this->store.clearDirty();
+    this->pack_dirty = false;
+    this->manifest.clear();
+    for(const loaded_file& file : files)
+    {
+        this->manifest[file.path.generic_string()] = {file.hash, file.size};
+    }
+    return errors;
+}
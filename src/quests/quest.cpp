@@ -1,207 +1,142 @@
-#include <iostream>
 #include <vector>
 #include <string>
 #include <quests/quest.h>
-#include <set>
-#include <functional>
 #include <files/basic_header.h>
+#include <quests/snbt_writer.h>
 
 
-bool quest::has_loop() 
+bool quest::hasNode(quest_handle n) const
 {
-    std::set<quest*> visited;
-    std::set<quest*> recursionStack;
-
-    std::function<bool(quest*)> dfs;
-    dfs = [&](quest* current) -> bool {
-        if(recursionStack.find(current) != recursionStack.end())
-        {
-            return true;
-        }
-        
-        if(visited.find(current) != visited.end())
-        {
-            return false;
-        }
-        
-        visited.insert(current);
-        recursionStack.insert(current);
-
-        for(connected_nodes& conn : current->linked_nodes) 
-        {
-            quest& next_node = *conn.node_linked;
-            if (dfs(&next_node)) return true;
-        }
-        recursionStack.erase(current);
-        return false;
-    };
-
-    return dfs(this);
-}
-
-bool quest::hasNode(quest n)
-{
-    for(connected_nodes& n1 : this->linked_nodes)
+    for(const connected_nodes& n1 : this->linked_nodes)
     {
-        quest& n2 = *n1.node_linked;
-        if(n2 == n) return true;
+        if(n1.node_linked == n) return true;
     }
     return false;
 }
 
-bool quest::addConnection(connected_nodes n)
-{
-    size_t size = this->linked_nodes.size();
-    this->linked_nodes.push_back(n);
-    if(this->has_loop())
-    {
-        this->linked_nodes.pop_back();
-    }
-    else
-    {
-        n.node_linked->needs_node_completed.push_back(this->id);
-    }
-    return this->linked_nodes.size() > size ? true : false;
-}
 
-
-static std::string shapeToString(Shapes s) {
-    switch(s) {
-        case Shapes::CIRCLE:    return "circle";
-        case Shapes::NO_SHAPE:  return "no_shape";
-        case Shapes::SQUARE:   return "square";
-        default:        return "default"; 
-    }
-}
-
-static std::string progressionToString(Progression p)
+//FTB's tristates are left out when they're the default
+static void tristate(quests::snbt_writer& w, std::string_view key, Hide value)
 {
-    return (p == Progression::LINEAR) ? "linear" : "default";
+    if(value != Hide::DEFAULT) w.boolean(key, value == Hide::HIDDEN);
 }
 
-std::string quest::generateQuest()
+void quest::write(quests::snbt_writer& w) const
 {
-    /*std::stringstream ss;
-    const std::string indent0(4, ' ');
-    const std::string indent1(8, ' ');
-    const std::string indent2(12, ' ');
-
-    ss << "{\n";
-
-    // 1. Icono (si existe)
-    if (!icon.empty()) {
-        ss << indent0 << "icon: {\n";
-        ss << indent1 << "id: \"" << icon << "\"\n";
-        ss << indent0 << "}\n";
-    }
-
-    // 2. ID (siempre presente)
-    ss << indent0 << "id: \"" << id << "\"\n";
-
-    auto rewardsList = getRewards();
-    if(!rewardsList.empty())
+    //keys in the order FTB Quests writes them (alphabetical), defaults skipped
+    w.beginObject();
+    tristate(w, "can_repeat", this->repeatable_quest);
+    if(!this->needs_node_completed.empty()) w.stringList("dependencies", this->needs_node_completed);
+    if(this->dependency_requirement != DependecyMode::ALL_COMPLETED)
     {
-        ss << indent0 << "rewards: [\n";
-        for(auto r : rewardsList)
-        {
-            // Llamada correcta al método generateReward() de cada objeto reward
-            for(auto c : r.getRewards())
-            {
-                std::string rewardStr = r.generateReward(c);
-            
-                // Procesar cada línea de la recompensa generada
-                std::istringstream rs(rewardStr);
-                std::string line;
-                while(std::getline(rs, line))
-                {
-                    if(!line.empty())
-                    {
-                        ss << indent1 << line << "\n";
-                    }
-                }
-            }
-        }
-        ss << indent0 << "]\n";
+        w.string("dependency_requirement", DEPENDENCY_MODE_NAMES[static_cast<size_t>(this->dependency_requirement)]);
     }
-
-    // 4. Forma (si no es DEFAULT)
-    if(shape != Shapes::DEFAULT)
+    if(!this->description.empty()) w.stringList("description", this->description);
+    tristate(w, "disable_jei", this->disable_jei_recipe);
+    if(this->disable_completion_toast) w.boolean("disable_toast", true);
+    if(!this->guide_page.empty()) w.string("guide_page", this->guide_page);
+    tristate(w, "hide_dependency_lines", this->hide_dependency_lines);
+    if(this->hide_dependent_lines) w.boolean("hide_dependent_lines", true);
+    tristate(w, "hide_details_until_startable", this->hide_details_until_startable);
+    tristate(w, "hide_text_until_complete", this->hide_text_until_completed);
+    tristate(w, "hide_until_deps_complete", this->hide_until_deps_completed);
+    tristate(w, "hide_until_deps_visible", this->hide_until_deps_visible);
+    if(!this->icon.empty())
     {
-        ss << indent0 << "shape: \"" << shapeToString(shape) << "\"\n";
+        w.beginObject("icon");
+        w.string("id", this->icon);
+        w.endObject();
     }
-
-    // 5. Tamaño (si es diferente de 0)
-    if(size != 0.0f)
+    if(this->icon_scaling != 1.0f) w.real("icon_scale", this->icon_scaling);
+    w.string("id", this->id);
+    if(this->ignore_reward_blocking) w.boolean("ignore_reward_blocking", true);
+    if(this->invisible_until_completed) w.boolean("invisible", true);
+    if(this->invisible_until_X_completed != 0) w.integer("invisible_until_tasks", this->invisible_until_X_completed);
+    if(this->min_required_dependecies != 0) w.integer("min_required_dependencies", this->min_required_dependecies);
+    if(this->min_opened_quest_window_width != 0) w.integer("min_width", this->min_opened_quest_window_width);
+    if(this->optional_quest) w.boolean("optional", true);
+    if(this->progression != Progression::DEFAULT)
     {
-        ss << indent0 << "size: " << std::fixed << std::setprecision(1) << size << "d\n";
+        w.string("progression_mode", PROGRESSION_NAMES[static_cast<size_t>(this->progression)]);
     }
-
-    // 6. Dependencias ocultas
-    if(hide_until_deps_completed)
+    tristate(w, "require_sequential_tasks", this->sequential_task_completion);
+    if(!this->rewards.empty())
     {
-        ss << indent0 << "hide_until_deps_complete: true\n";
+        w.beginList("rewards");
+        for(const reward& r : this->rewards) r.write(w);
+        w.endList();
     }
-
-    // 7. Opcional
-    if(optional)
+    if(this->shape != Shapes::DEFAULT) w.string("shape", SHAPE_NAMES[static_cast<size_t>(this->shape)]);
+    if(this->size != 0.0f) w.real("size", this->size);
+    if(!this->subtitle.empty()) w.string("subtitle", this->subtitle);
+    if(!this->tags.empty())
     {
-        ss << indent0 << "optional: true\n";
+        w.beginList("tags");
+        for(const snbt::Tag& tag : this->tags) w.tag({}, tag);
+        w.endList();
     }
-
-    // 8. Modo de progresión
-    if(progression != Progression::DEFAULT)
+    if(!this->tasks.empty())
     {
-        ss << indent0 << "progression_mode: \"" << progressionToString(progression) << "\"\n";
+        w.beginList("tasks");
+        for(const snbt::Tag& task : this->tasks) w.tag({}, task);
+        w.endList();
     }
+    if(!this->title.empty()) w.string("title", this->title);
+    w.real("x", this->position.x);
+    w.real("y", this->position.y);
+    w.endObject();
+}
 
-    // 9. Tareas (requirements)
-    auto tasks = getTasks();
-    if(!tasks.empty())
-    {
-        ss << indent0 << "tasks: [\n";
-        for(auto t : requirements)
-        {
-            ss << indent1 << "{\n";
-            
-            // ID de la tarea
-            ss << indent2 << "id: \"" << t.quest_id << "\"\n";
-            
-            // Tipo de tarea
-            ss << indent2 << "type: \"" << typetoString(t.type) << "\"\n";
-            
-            // Item (si es tipo "item")
-            if(t.type == TYPE::ITEM)
-            {
-                ss << indent2 << "item: { ";
-                ss << "count: " << t.items.count;
-                if(!t.items.id.empty())
-                {
-                    ss << ", id: \"" << t.items.id << "\"";
-                }
-                ss << " }\n";
-            }
-            ss << indent1 << "}\n";
-        }
-        ss << indent0 << "]\n";
-    }
+std::string quest::generateQuest() const
+{
+    std::string out;
+    quests::snbt_writer w(out);
+    this->write(w);
+    return out;
+}
 
-    // 10. Dependencias (nodos requeridos)
-    if(!needs_node_completed.empty())
+void quest::read(const snbt::Compound& values)
+{
+    const quests::snbt_reader r(values);
+    r.tristate("can_repeat", this->repeatable_quest);
+    r.stringList("dependencies", this->needs_node_completed);
+    r.name("dependency_requirement", DEPENDENCY_MODE_NAMES, this->dependency_requirement);
+    r.stringList("description", this->description);
+    r.tristate("disable_jei", this->disable_jei_recipe);
+    r.boolean("disable_toast", this->disable_completion_toast);
+    r.string("guide_page", this->guide_page);
+    r.tristate("hide_dependency_lines", this->hide_dependency_lines);
+    r.boolean("hide_dependent_lines", this->hide_dependent_lines);
+    r.tristate("hide_details_until_startable", this->hide_details_until_startable);
+    r.tristate("hide_text_until_complete", this->hide_text_until_completed);
+    r.tristate("hide_until_deps_complete", this->hide_until_deps_completed);
+    r.tristate("hide_until_deps_visible", this->hide_until_deps_visible);
+    r.itemId("icon", this->icon);
+    r.number("icon_scale", this->icon_scaling);
+    r.string("id", this->id);
+    r.boolean("ignore_reward_blocking", this->ignore_reward_blocking);
+    r.boolean("invisible", this->invisible_until_completed);
+    r.number("invisible_until_tasks", this->invisible_until_X_completed);
+    r.number("min_required_dependencies", this->min_required_dependecies);
+    r.number("min_width", this->min_opened_quest_window_width);
+    r.boolean("optional", this->optional_quest);
+    r.name("progression_mode", PROGRESSION_NAMES, this->progression);
+    r.tristate("require_sequential_tasks", this->sequential_task_completion);
+    if(const snbt::List* list = r.list("rewards"))
     {
-        ss << indent0 << "dependencies: [\n";
-        for(auto dep : needs_node_completed)
+        this->rewards.reserve(list->size());
+        for(const snbt::Tag& item : *list)
         {
-            ss << indent1 << "\"" << dep << "\"\n";
+            if(item.type() != snbt::Tag::Type::Compound) continue;
+            this->rewards.emplace_back().read(item.as<snbt::Compound>());
         }
-        ss << indent0 << "]\n";
     }
-
-    // 11. Posición (siempre presente)
-    vec2 pos = getPosition();
-    ss << indent0 << "x: " << pos.x << ".0d\n";
-    ss << indent0 << "y: " << pos.y << ".0d\n";
-
-    ss << "}";
-    return ss.str()*/
-    return "hola";
-}
\ No newline at end of file
+    r.name("shape", SHAPE_NAMES, this->shape);
+    r.number("size", this->size);
+    r.string("subtitle", this->subtitle);
+    if(const snbt::List* list = r.list("tags")) this->tags = *list;
+    if(const snbt::List* list = r.list("tasks")) this->tasks.assign(list->begin(), list->end());
+    r.string("title", this->title);
+    r.number("x", this->position.x);
+    r.number("y", this->position.y);
+}
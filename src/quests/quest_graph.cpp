@@ -0,0 +1,388 @@
+#include <quests/quest_graph.h>
+#include <algorithm>
+
+namespace
+{
+    //Order doesn't matter in the adjacency vectors, the last one takes the hole
+    bool eraseUnordered(std::vector<quest_graph::node>& list, quest_graph::node n)
+    {
+        auto it = std::find(list.begin(), list.end(), n);
+        if(it == list.end()) return false;
+        *it = list.back();
+        list.pop_back();
+        return true;
+    }
+}
+
+quest_graph::node quest_graph::addNode(const std::string& id)
+{
+    auto found = this->index.find(id);
+    if(found != this->index.end()) return found->second;
+
+    node n;
+    if(!this->free_nodes.empty())
+    {
+        //a quest without edges can be anywhere in the order, the old position is still valid
+        n = this->free_nodes.back();
+        this->free_nodes.pop_back();
+        this->ids[n] = id;
+        this->live[n] = true;
+    }
+    else
+    {
+        n = static_cast<node>(this->ids.size());
+        this->ids.push_back(id);
+        this->live.push_back(true);
+        this->out.emplace_back();
+        this->in.emplace_back();
+        this->mark.push_back(0);
+        this->ord.push_back(static_cast<uint32_t>(this->at.size()));
+        this->at.push_back(n);
+    }
+    this->index.emplace(id, n);
+    return n;
+}
+
+bool quest_graph::removeNode(node n)
+{
+    if(!contains(n)) return false;
+
+    for(node d : this->out[n]) eraseUnordered(this->in[d], n);
+    for(node p : this->in[n]) eraseUnordered(this->out[p], n);
+    this->edges -= this->out[n].size() + this->in[n].size();
+    this->out[n].clear();
+    this->in[n].clear();
+
+    this->index.erase(this->ids[n]);
+    this->ids[n].clear();
+    this->live[n] = false;
+    this->free_nodes.push_back(n);
+    return true;
+}
+
+quest_graph::node quest_graph::find(std::string_view id) const
+{
+    auto found = this->index.find(id);
+    return found != this->index.end() ? found->second : npos;
+}
+
+const std::string& quest_graph::idOf(node n) const
+{
+    return this->ids[n];
+}
+
+bool quest_graph::contains(node n) const
+{
+    return n < this->live.size() && this->live[n];
+}
+
+uint32_t quest_graph::nextEpoch()
+{
+    if(++this->epoch == 0)
+    {
+        std::fill(this->mark.begin(), this->mark.end(), 0);
+        this->epoch = 1;
+    }
+    return this->epoch;
+}
+
+/**
+ * @brief Everything reachable from `from` placed before `upper` in the order
+ * Reaching target means the new edge closes a loop
+ */
+bool quest_graph::visitForward(node from, node target, uint32_t upper)
+{
+    const uint32_t current = nextEpoch();
+    this->stack.assign(1, from);
+    this->mark[from] = current;
+    while(!this->stack.empty())
+    {
+        const node n = this->stack.back();
+        this->stack.pop_back();
+        this->forward.push_back(n);
+        for(node next : this->out[n])
+        {
+            if(next == target) return false;
+            if(this->mark[next] != current && this->ord[next] < upper)
+            {
+                this->mark[next] = current;
+                this->stack.push_back(next);
+            }
+        }
+    }
+    return true;
+}
+
+//Everything that reaches `from` placed after `lower` in the order
+void quest_graph::visitBackward(node from, uint32_t lower)
+{
+    const uint32_t current = nextEpoch();
+    this->stack.assign(1, from);
+    this->mark[from] = current;
+    while(!this->stack.empty())
+    {
+        const node n = this->stack.back();
+        this->stack.pop_back();
+        this->backward.push_back(n);
+        for(node previous : this->in[n])
+        {
+            if(this->mark[previous] != current && this->ord[previous] > lower)
+            {
+                this->mark[previous] = current;
+                this->stack.push_back(previous);
+            }
+        }
+    }
+}
+
+//The visited quests keep their positions between them, the ones reaching `from` go first
+void quest_graph::reorder()
+{
+    auto by_order = [this](node a, node b) { return this->ord[a] < this->ord[b]; };
+    std::sort(this->forward.begin(), this->forward.end(), by_order);
+    std::sort(this->backward.begin(), this->backward.end(), by_order);
+
+    this->slots.clear();
+    for(node n : this->backward) this->slots.push_back(this->ord[n]);
+    for(node n : this->forward) this->slots.push_back(this->ord[n]);
+    std::sort(this->slots.begin(), this->slots.end());
+
+    size_t i = 0;
+    for(const auto* list : {&this->backward, &this->forward})
+    {
+        for(node n : *list)
+        {
+            this->ord[n] = this->slots[i];
+            this->at[this->slots[i]] = n;
+            i++;
+        }
+    }
+}
+
+bool quest_graph::addEdge(node from, node to)
+{
+    if(from == to || !contains(from) || !contains(to)) return false;
+    if(hasEdge(from, to)) return true;
+
+    if(this->ord[from] > this->ord[to])
+    {
+        //only the quests between both ends of the order can be in the wrong place
+        this->forward.clear();
+        this->backward.clear();
+        if(!visitForward(to, from, this->ord[from])) return false;
+        visitBackward(from, this->ord[to]);
+        reorder();
+    }
+
+    this->out[from].push_back(to);
+    this->in[to].push_back(from);
+    this->edges++;
+    return true;
+}
+
+/**
+ * @brief Strongly connected component of every quest (Tarjan), two quests share one if they are on a loop
+ * Iterative, a long chain of dependencies would overflow the call stack
+ */
+std::vector<uint32_t> quest_graph::components() const
+{
+    constexpr uint32_t unseen = UINT32_MAX;
+    const size_t count = this->out.size();
+    std::vector<uint32_t> seen(count, unseen), low(count), component(count, unseen);
+    std::vector<node> path;
+    std::vector<std::pair<node, uint32_t>> calls; //quest, next of its dependents to visit
+    uint32_t next_seen = 0;
+    uint32_t next_component = 0;
+
+    for(node root = 0; root < count; root++)
+    {
+        if(seen[root] != unseen) continue;
+        seen[root] = low[root] = next_seen++;
+        path.push_back(root);
+        calls.emplace_back(root, 0);
+        while(!calls.empty())
+        {
+            auto& [n, edge] = calls.back();
+            if(edge < this->out[n].size())
+            {
+                const node next = this->out[n][edge++];
+                if(seen[next] == unseen)
+                {
+                    seen[next] = low[next] = next_seen++;
+                    path.push_back(next);
+                    calls.emplace_back(next, 0);
+                }
+                else if(component[next] == unseen)
+                {
+                    low[n] = std::min(low[n], seen[next]);
+                }
+                continue;
+            }
+
+            const node done = n;
+            calls.pop_back();
+            if(!calls.empty())
+            {
+                const node parent = calls.back().first;
+                low[parent] = std::min(low[parent], low[done]);
+            }
+            if(low[done] == seen[done])
+            {
+                node member;
+                do
+                {
+                    member = path.back();
+                    path.pop_back();
+                    component[member] = next_component;
+                }
+                while(member != done);
+                next_component++;
+            }
+        }
+    }
+    return component;
+}
+
+//Makes the whole order again (Kahn), false if some quests are on a loop and nothing changes then
+bool quest_graph::sortAll()
+{
+    std::vector<uint32_t> waiting(this->at.size());
+    std::vector<node> sorted;
+    sorted.reserve(this->at.size());
+    //starting from the old order keeps the quests that didn't move close to where they were
+    for(node n : this->at)
+    {
+        waiting[n] = static_cast<uint32_t>(this->in[n].size());
+        if(waiting[n] == 0) sorted.push_back(n);
+    }
+    for(size_t i = 0; i < sorted.size(); i++)
+    {
+        for(node next : this->out[sorted[i]])
+        {
+            if(--waiting[next] == 0) sorted.push_back(next);
+        }
+    }
+    if(sorted.size() != this->at.size()) return false;
+
+    this->at = std::move(sorted);
+    for(uint32_t position = 0; position < this->at.size(); position++) this->ord[this->at[position]] = position;
+    return true;
+}
+
+std::vector<quest_graph::edge_result> quest_graph::addEdges(std::span<const std::pair<node, node>> list)
+{
+    std::vector<edge_result> result(list.size(), edge_result::LOOP);
+    bool against = false;
+    for(size_t i = 0; i < list.size(); i++)
+    {
+        const auto [from, to] = list[i];
+        if(from == to || !contains(from) || !contains(to)) continue;
+        if(hasEdge(from, to))
+        {
+            result[i] = edge_result::EXISTS;
+            continue;
+        }
+        this->out[from].push_back(to);
+        this->in[to].push_back(from);
+        this->edges++;
+        result[i] = edge_result::ADDED;
+        against = against || this->ord[from] > this->ord[to];
+    }
+    if(!against || sortAll()) return result;
+
+    //an edge closes a loop only with edges of its own component, the ones inside a component are
+    //taken out and added again in the batch order, so the same ones as with addEdge are refused
+    const std::vector<uint32_t> component = components();
+    std::vector<size_t> retry;
+    for(size_t i = 0; i < list.size(); i++)
+    {
+        const auto [from, to] = list[i];
+        if(result[i] != edge_result::ADDED || component[from] != component[to]) continue;
+        eraseUnordered(this->out[from], to);
+        eraseUnordered(this->in[to], from);
+        this->edges--;
+        retry.push_back(i);
+    }
+    sortAll();
+    for(size_t i : retry)
+    {
+        result[i] = addEdge(list[i].first, list[i].second) ? edge_result::ADDED : edge_result::LOOP;
+    }
+    //a repeat of an edge that got refused is refused too
+    for(size_t i = 0; i < list.size(); i++)
+    {
+        if(result[i] == edge_result::EXISTS && !hasEdge(list[i].first, list[i].second)) result[i] = edge_result::LOOP;
+    }
+    return result;
+}
+
+bool quest_graph::removeEdge(node from, node to)
+{
+    if(!contains(from) || !contains(to) || !eraseUnordered(this->out[from], to)) return false;
+    eraseUnordered(this->in[to], from);
+    this->edges--;
+    return true;
+}
+
+bool quest_graph::hasEdge(node from, node to) const
+{
+    //look at the shorter side, most quests have a handful of dependencies
+    if(this->out[from].size() <= this->in[to].size())
+    {
+        return std::find(this->out[from].begin(), this->out[from].end(), to) != this->out[from].end();
+    }
+    return std::find(this->in[to].begin(), this->in[to].end(), from) != this->in[to].end();
+}
+
+const std::vector<quest_graph::node>& quest_graph::dependents(node n) const
+{
+    return this->out[n];
+}
+
+const std::vector<quest_graph::node>& quest_graph::dependencies(node n) const
+{
+    return this->in[n];
+}
+
+uint32_t quest_graph::position(node n) const
+{
+    return this->ord[n];
+}
+
+std::vector<quest_graph::node> quest_graph::order() const
+{
+    std::vector<node> result;
+    result.reserve(this->index.size());
+    for(node n : this->at)
+    {
+        if(this->live[n]) result.push_back(n);
+    }
+    return result;
+}
+
+size_t quest_graph::size() const
+{
+    return this->index.size();
+}
+
+size_t quest_graph::edgeCount() const
+{
+    return this->edges;
+}
+
+void quest_graph::reserve(size_t nodes)
+{
+    this->index.reserve(nodes);
+    this->ids.reserve(nodes);
+    this->live.reserve(nodes);
+    this->out.reserve(nodes);
+    this->in.reserve(nodes);
+    this->mark.reserve(nodes);
+    this->ord.reserve(nodes);
+    this->at.reserve(nodes);
+}
+
+void quest_graph::clear()
+{
+    *this = quest_graph();
+}
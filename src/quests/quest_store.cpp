@@ -0,0 +1,359 @@
+#include <quests/quest_store.h>
+#include <algorithm>
+
+namespace
+{
+    void setFlag(std::vector<uint8_t>& flags, uint32_t index)
+    {
+        if(flags.size() <= index) flags.resize(index + 1);
+        flags[index] = 1;
+    }
+
+    bool getFlag(const std::vector<uint8_t>& flags, uint32_t index)
+    {
+        return index < flags.size() && flags[index];
+    }
+}
+
+chapter_handle quest_store::addChapter(chapter&& c)
+{
+    const chapter_handle h = this->chapters.insert(std::move(c));
+    this->markDirty(h);
+    return h;
+}
+
+bool quest_store::removeChapter(chapter_handle c)
+{
+    chapter* target = this->chapters.get(c);
+    if(target == nullptr)
+    {
+        return false;
+    }
+    //removing a quest changes the chapter's list, it's emptied from the back
+    while(!target->quests.empty())
+    {
+        this->removeQuest(target->quests.back());
+    }
+    this->removed = true;
+    return this->chapters.erase(c);
+}
+
+quest_handle quest_store::addQuest(chapter_handle c, quest&& q)
+{
+    chapter* target = this->chapters.get(c);
+    if(target == nullptr || this->quest_ids.contains(q.id))
+    {
+        return {};
+    }
+
+    const std::string id = q.id;
+    const quest_handle h = this->quests.insert(std::move(q));
+    this->quest_ids.emplace(id, h);
+    target->addQuest(h, id);
+
+    const quest_graph::node n = this->dependencies.addNode(id);
+    if(this->chapter_of.size() <= h.index)
+    {
+        this->chapter_of.resize(h.index + 1);
+        this->node_of.resize(h.index + 1);
+    }
+    if(this->quest_at.size() <= n)
+    {
+        this->quest_at.resize(n + 1);
+    }
+    this->chapter_of[h.index] = c;
+    this->node_of[h.index] = n;
+    this->quest_at[n] = h;
+    this->markDirty(h);
+    return h;
+}
+
+//Takes the quest out of every dependency, both ways
+void quest_store::unlinkAll(quest_handle q)
+{
+    const quest_graph::node n = this->node_of[q.index];
+    const std::string& id = this->quests.get(q)->id;
+
+    for(quest_graph::node dependent : this->dependencies.dependents(n))
+    {
+        this->markDirty(this->quest_at[dependent]);
+        auto& needs = this->quests.get(this->quest_at[dependent])->needs_node_completed;
+        needs.erase(std::remove(needs.begin(), needs.end(), id), needs.end());
+    }
+    for(quest_graph::node dependency : this->dependencies.dependencies(n))
+    {
+        auto& linked = this->quests.get(this->quest_at[dependency])->linked_nodes;
+        linked.erase(std::remove_if(linked.begin(), linked.end(), [q](const connected_nodes& c) {
+            return c.node_linked == q;
+        }), linked.end());
+    }
+}
+
+bool quest_store::removeQuest(quest_handle q)
+{
+    quest* target = this->quests.get(q);
+    if(target == nullptr)
+    {
+        return false;
+    }
+
+    this->unlinkAll(q);
+    this->dependencies.removeNode(this->node_of[q.index]);
+    if(chapter* owner = this->chapters.get(this->chapter_of[q.index]))
+    {
+        owner->removeQuest(target->id, this->quests);
+        this->markDirty(this->chapter_of[q.index]);
+    }
+    this->quest_ids.erase(target->id);
+    return this->quests.erase(q);
+}
+
+bool quest_store::moveQuest(quest_handle q, chapter_handle to)
+{
+    quest* target = this->quests.get(q);
+    chapter* destination = this->chapters.get(to);
+    if(target == nullptr || destination == nullptr)
+    {
+        return false;
+    }
+    if(this->chapter_of[q.index] == to)
+    {
+        return true;
+    }
+
+    if(chapter* owner = this->chapters.get(this->chapter_of[q.index]))
+    {
+        owner->removeQuest(target->id, this->quests);
+        this->markDirty(this->chapter_of[q.index]);
+    }
+    destination->addQuest(q, target->id);
+    this->chapter_of[q.index] = to;
+    this->markDirty(q);
+    return true;
+}
+
+reward_handle quest_store::addRewardTable(reward&& r)
+{
+    const reward_handle h = this->reward_tables.insert(std::move(r));
+    this->markDirty(h);
+    return h;
+}
+
+bool quest_store::removeRewardTable(reward_handle r)
+{
+    if(!this->reward_tables.erase(r))
+    {
+        return false;
+    }
+    this->removed = true;
+    return true;
+}
+
+bool quest_store::link(quest_handle from, quest_handle to, int value)
+{
+    quest* source = this->quests.get(from);
+    quest* target = this->quests.get(to);
+    if(source == nullptr || target == nullptr)
+    {
+        return false;
+    }
+
+    const quest_graph::node a = this->node_of[from.index];
+    const quest_graph::node b = this->node_of[to.index];
+    if(this->dependencies.hasEdge(a, b))
+    {
+        return true;
+    }
+    if(!this->dependencies.addEdge(a, b))
+    {
+        return false;
+    }
+    source->linked_nodes.push_back({value, to});
+    target->needs_node_completed.push_back(source->id);
+    this->markDirty(to); //only the dependent writes the dependency
+    return true;
+}
+
+std::vector<bool> quest_store::linkAll(std::span<const std::pair<quest_handle, quest_handle>> links)
+{
+    std::vector<bool> result(links.size(), false);
+    std::vector<std::pair<quest_graph::node, quest_graph::node>> edges;
+    std::vector<size_t> edge_of; //index in links of every edge
+    edges.reserve(links.size());
+    edge_of.reserve(links.size());
+    for(size_t i = 0; i < links.size(); i++)
+    {
+        const auto& [from, to] = links[i];
+        if(!this->quests.contains(from) || !this->quests.contains(to)) continue;
+        edges.emplace_back(this->node_of[from.index], this->node_of[to.index]);
+        edge_of.push_back(i);
+    }
+
+    const auto added = this->dependencies.addEdges(edges);
+    for(size_t e = 0; e < edges.size(); e++)
+    {
+        const auto& [from, to] = links[edge_of[e]];
+        switch(added[e])
+        {
+            case quest_graph::edge_result::ADDED:
+            {
+                quest* source = this->quests.get(from);
+                source->linked_nodes.push_back({0, to});
+                this->quests.get(to)->needs_node_completed.push_back(source->id);
+                this->markDirty(to);
+                result[edge_of[e]] = true;
+                break;
+            }
+            case quest_graph::edge_result::EXISTS:
+                result[edge_of[e]] = true;
+                break;
+            case quest_graph::edge_result::LOOP:
+                break;
+        }
+    }
+    return result;
+}
+
+bool quest_store::unlink(quest_handle from, quest_handle to)
+{
+    quest* source = this->quests.get(from);
+    quest* target = this->quests.get(to);
+    if(source == nullptr || target == nullptr ||
+       !this->dependencies.removeEdge(this->node_of[from.index], this->node_of[to.index]))
+    {
+        return false;
+    }
+
+    auto& linked = source->linked_nodes;
+    linked.erase(std::remove_if(linked.begin(), linked.end(), [to](const connected_nodes& c) {
+        return c.node_linked == to;
+    }), linked.end());
+    auto& needs = target->needs_node_completed;
+    needs.erase(std::remove(needs.begin(), needs.end(), source->id), needs.end());
+    this->markDirty(to);
+    return true;
+}
+
+quest* quest_store::getQuest(quest_handle q)
+{
+    quest* found = this->quests.get(q);
+    if(found != nullptr) this->markDirty(q);
+    return found;
+}
+
+const quest* quest_store::getQuest(quest_handle q) const
+{
+    return this->quests.get(q);
+}
+
+chapter* quest_store::getChapter(chapter_handle c)
+{
+    chapter* found = this->chapters.get(c);
+    if(found != nullptr) this->markDirty(c);
+    return found;
+}
+
+const chapter* quest_store::getChapter(chapter_handle c) const
+{
+    return this->chapters.get(c);
+}
+
+reward* quest_store::getRewardTable(reward_handle r)
+{
+    reward* found = this->reward_tables.get(r);
+    if(found != nullptr) this->markDirty(r);
+    return found;
+}
+
+const reward* quest_store::getRewardTable(reward_handle r) const
+{
+    return this->reward_tables.get(r);
+}
+
+//A quest is written in its chapter's file, so the chapter is dirty too
+void quest_store::markDirty(quest_handle q)
+{
+    if(!this->quests.contains(q)) return;
+    setFlag(this->quest_dirty, q.index);
+    this->markDirty(this->chapter_of[q.index]);
+}
+
+void quest_store::markDirty(chapter_handle c)
+{
+    if(this->chapters.contains(c)) setFlag(this->chapter_dirty, c.index);
+}
+
+void quest_store::markDirty(reward_handle r)
+{
+    if(this->reward_tables.contains(r)) setFlag(this->table_dirty, r.index);
+}
+
+bool quest_store::isDirty(quest_handle q) const
+{
+    return this->quests.contains(q) && getFlag(this->quest_dirty, q.index);
+}
+
+bool quest_store::isDirty(chapter_handle c) const
+{
+    return this->chapters.contains(c) && getFlag(this->chapter_dirty, c.index);
+}
+
+bool quest_store::isDirty(reward_handle r) const
+{
+    return this->reward_tables.contains(r) && getFlag(this->table_dirty, r.index);
+}
+
+bool quest_store::hasRemovals() const
+{
+    return this->removed;
+}
+
+void quest_store::clearDirty()
+{
+    this->removed = false;
+    std::fill(this->quest_dirty.begin(), this->quest_dirty.end(), 0);
+    std::fill(this->chapter_dirty.begin(), this->chapter_dirty.end(), 0);
+    std::fill(this->table_dirty.begin(), this->table_dirty.end(), 0);
+}
+
+quest_handle quest_store::findQuest(std::string_view quest_id) const
+{
+    auto it = this->quest_ids.find(quest_id);
+    return it != this->quest_ids.end() ? it->second : quest_handle{};
+}
+
+chapter_handle quest_store::chapterOf(quest_handle q) const
+{
+    return this->quests.contains(q) ? this->chapter_of[q.index] : chapter_handle{};
+}
+
+const quests::slot_map<quest>& quest_store::allQuests() const
+{
+    return this->quests;
+}
+
+const quests::slot_map<chapter>& quest_store::allChapters() const
+{
+    return this->chapters;
+}
+
+const quests::slot_map<reward>& quest_store::allRewardTables() const
+{
+    return this->reward_tables;
+}
+
+const quest_graph& quest_store::graph() const
+{
+    return this->dependencies;
+}
+
+void quest_store::reserve(size_t quest_count, size_t chapter_count)
+{
+    this->quests.reserve(quest_count);
+    this->chapters.reserve(chapter_count);
+    this->quest_ids.reserve(quest_count);
+    this->dependencies.reserve(quest_count);
+    this->chapter_of.reserve(quest_count);
+    this->node_of.reserve(quest_count);
+    this->quest_at.reserve(quest_count);
+}
@@ -2,9 +2,63 @@
 #include <quests/uuid.h>
 #include <string>
 
-std::string reward::generateReward()
+void reward::write(quests::snbt_writer& w) const
 {
-    return "";
+    //keys in the order FTB Quests writes them (alphabetical), defaults skipped
+    w.beginObject();
+    if(this->auto_claim != Hide::DEFAULT) w.string("auto", this->auto_claim == Hide::HIDDEN ? "enabled" : "disabled");
+    if(this->count != 1) w.integer("count", this->count);
+    if(this->exclude_from_claim_all) w.boolean("exclude_from_claim_all", true);
+    if(!this->icon.empty())
+    {
+        w.beginObject("icon");
+        w.string("id", this->icon);
+        w.endObject();
+    }
+    w.string("id", this->id);
+    if(this->ignore_reward_blocking) w.boolean("ignore_reward_blocking", true);
+    if(!this->item_id.empty()) w.string("item", this->item_id);
+    if(this->only_one) w.boolean("only_one", true);
+    if(this->random_bonus != 0) w.integer("random_bonus", this->random_bonus);
+    if(!this->tags.empty())
+    {
+        w.beginList("tags");
+        for(const snbt::Tag& tag : this->tags) w.tag({}, tag);
+        w.endList();
+    }
+    if(this->team_reward != Hide::DEFAULT) w.boolean("team_reward", this->team_reward == Hide::HIDDEN);
+    if(!this->title.empty()) w.string("title", this->title);
+    w.string("type", this->item_id.empty() ? "custom" : "item");
+    w.endObject();
 }
 
+std::string reward::generateReward() const
+{
+    std::string out;
+    quests::snbt_writer w(out);
+    this->write(w);
+    return out;
+}
 
+void reward::read(const snbt::Compound& values)
+{
+    const quests::snbt_reader r(values);
+    std::string claim;
+    if(r.string("auto", claim))
+    {
+        //"no_toast" and "invisible" claim too, they just don't show it
+        if(claim == "disabled") this->auto_claim = Hide::VISIBLE;
+        else if(claim != "default") this->auto_claim = Hide::HIDDEN;
+    }
+    r.number("count", this->count);
+    r.boolean("exclude_from_claim_all", this->exclude_from_claim_all);
+    r.itemId("icon", this->icon);
+    r.string("id", this->id);
+    r.boolean("ignore_reward_blocking", this->ignore_reward_blocking);
+    r.itemId("item", this->item_id);
+    r.boolean("only_one", this->only_one);
+    r.number("random_bonus", this->random_bonus);
+    if(const snbt::List* list = r.list("tags")) this->tags = *list;
+    r.tristate("team_reward", this->team_reward);
+    r.string("title", this->title);
+}